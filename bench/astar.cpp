@@ -0,0 +1,595 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2015  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Compares the open list and node lookup of Map::getPathMatching before and
+// after the binary heap / flat node table change (AStarNodes in map.cpp),
+// running the unchanged search loop over plain grids instead of the map.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <forward_list>
+#include <limits>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+enum Direction {
+	DIRECTION_NORTH,
+	DIRECTION_EAST,
+	DIRECTION_SOUTH,
+	DIRECTION_WEST,
+	DIRECTION_SOUTHWEST,
+	DIRECTION_SOUTHEAST,
+	DIRECTION_NORTHWEST,
+	DIRECTION_NORTHEAST,
+};
+
+struct Position {
+	uint16_t x, y;
+};
+
+struct FindPathParams {
+	bool allowDiagonal;
+	int32_t maxSearchDist;
+};
+
+#define MAX_NODES 512
+#define GET_NODE_INDEX(a) (a - &nodes[0])
+
+#define MAP_NORMALWALKCOST 10
+#define MAP_DIAGONALWALKCOST 25
+
+#define GRID_SIZE 64
+#define GRID_BASE 1000
+
+// a walkable cell costs 0, or the extra cost of a field on it, -1 blocks it
+struct Grid {
+	int32_t cells[GRID_SIZE * GRID_SIZE];
+
+	const int32_t* getCell(uint32_t x, uint32_t y) const {
+		x -= GRID_BASE;
+		y -= GRID_BASE;
+		if (x >= GRID_SIZE || y >= GRID_SIZE) {
+			return nullptr;
+		}
+		return &cells[y * GRID_SIZE + x];
+	}
+};
+
+struct AStarNode {
+	AStarNode* parent;
+	int_fast32_t f;
+	uint16_t x, y;
+};
+
+namespace old_nodes {
+
+// AStarNodes as it was: linear scan for the best open node, nodes looked up
+// through an unordered_map
+class AStarNodes
+{
+	public:
+		AStarNodes(uint32_t x, uint32_t y);
+
+		AStarNode* createOpenNode(AStarNode* parent, uint32_t x, uint32_t y, int_fast32_t f);
+		AStarNode* getBestNode();
+		void closeNode(AStarNode* node);
+		void openNode(AStarNode* node);
+		int_fast32_t getClosedNodes() const {
+			return closedNodes;
+		}
+		AStarNode* getNodeByPosition(uint32_t x, uint32_t y);
+
+	private:
+		AStarNode nodes[MAX_NODES];
+		bool openNodes[MAX_NODES];
+		std::unordered_map<uint32_t, AStarNode*> nodeTable;
+		size_t curNode;
+		int_fast32_t closedNodes;
+};
+
+AStarNodes::AStarNodes(uint32_t x, uint32_t y)
+	: openNodes()
+{
+	curNode = 1;
+	closedNodes = 0;
+	openNodes[0] = true;
+
+	AStarNode& startNode = nodes[0];
+	startNode.parent = nullptr;
+	startNode.x = x;
+	startNode.y = y;
+	startNode.f = 0;
+	nodeTable[(x << 16) | y] = &startNode;
+}
+
+AStarNode* AStarNodes::createOpenNode(AStarNode* parent, uint32_t x, uint32_t y, int_fast32_t f)
+{
+	if (curNode >= MAX_NODES) {
+		return nullptr;
+	}
+
+	size_t retNode = curNode++;
+	openNodes[retNode] = true;
+
+	AStarNode* node = &nodes[retNode];
+	nodeTable[(x << 16) | y] = node;
+	node->parent = parent;
+	node->x = x;
+	node->y = y;
+	node->f = f;
+	return node;
+}
+
+AStarNode* AStarNodes::getBestNode()
+{
+	if (curNode == 0) {
+		return nullptr;
+	}
+
+	int32_t best_node_f = std::numeric_limits<int32_t>::max();
+	int32_t best_node = -1;
+	for (size_t i = 0; i < curNode; i++) {
+		if (openNodes[i] && nodes[i].f < best_node_f) {
+			best_node_f = nodes[i].f;
+			best_node = i;
+		}
+	}
+
+	if (best_node >= 0) {
+		return &nodes[best_node];
+	}
+	return nullptr;
+}
+
+void AStarNodes::closeNode(AStarNode* node)
+{
+	openNodes[GET_NODE_INDEX(node)] = false;
+	++closedNodes;
+}
+
+void AStarNodes::openNode(AStarNode* node)
+{
+	size_t pos = GET_NODE_INDEX(node);
+	if (!openNodes[pos]) {
+		openNodes[pos] = true;
+		--closedNodes;
+	}
+}
+
+AStarNode* AStarNodes::getNodeByPosition(uint32_t x, uint32_t y)
+{
+	auto it = nodeTable.find((x << 16) | y);
+	if (it == nodeTable.end()) {
+		return nullptr;
+	}
+	return it->second;
+}
+
+}
+
+namespace new_nodes {
+
+// open list entries, stale ones (closed nodes or nodes that got cheaper since) are skipped
+#define MAX_OPEN_ENTRIES 1024
+
+// nodes are looked up by their position inside a 32x32 window, with linear probing
+#define NODE_TABLE_BITS 5
+#define NODE_TABLE_SIZE (1 << (NODE_TABLE_BITS * 2))
+
+// AStarNodes as in map.cpp now
+class AStarNodes
+{
+	public:
+		AStarNodes(uint32_t x, uint32_t y);
+
+		AStarNode* createOpenNode(AStarNode* parent, uint32_t x, uint32_t y, int_fast32_t f);
+		AStarNode* getBestNode();
+		void closeNode(AStarNode* node);
+		void openNode(AStarNode* node);
+		int_fast32_t getClosedNodes() const {
+			return closedNodes;
+		}
+		AStarNode* getNodeByPosition(uint32_t x, uint32_t y);
+
+	private:
+		struct OpenEntry {
+			int32_t f;
+			uint16_t index;
+
+			// orders the open list as a min-heap by cost, ties go to the older node
+			bool operator<(const OpenEntry& other) const {
+				return f > other.f || (f == other.f && index > other.index);
+			}
+		};
+
+		void pushOpenEntry(size_t index);
+
+		AStarNode nodes[MAX_NODES];
+		bool openNodes[MAX_NODES];
+		OpenEntry openEntries[MAX_OPEN_ENTRIES];
+		// node index + 1, 0 marks an empty slot
+		uint16_t nodeTable[NODE_TABLE_SIZE];
+		size_t openEntryCount;
+		size_t curNode;
+		int_fast32_t closedNodes;
+};
+
+static inline size_t getNodeTableSlot(uint32_t x, uint32_t y)
+{
+	const uint32_t mask = (1 << NODE_TABLE_BITS) - 1;
+	return ((x & mask) << NODE_TABLE_BITS) | (y & mask);
+}
+
+AStarNodes::AStarNodes(uint32_t x, uint32_t y)
+	: nodeTable()
+{
+	curNode = 1;
+	closedNodes = 0;
+	openNodes[0] = true;
+	openEntryCount = 0;
+
+	AStarNode& startNode = nodes[0];
+	startNode.parent = nullptr;
+	startNode.x = x;
+	startNode.y = y;
+	startNode.f = 0;
+	nodeTable[getNodeTableSlot(x, y)] = 1;
+	pushOpenEntry(0);
+}
+
+AStarNode* AStarNodes::createOpenNode(AStarNode* parent, uint32_t x, uint32_t y, int_fast32_t f)
+{
+	if (curNode >= MAX_NODES) {
+		return nullptr;
+	}
+
+	size_t retNode = curNode++;
+	openNodes[retNode] = true;
+
+	AStarNode* node = &nodes[retNode];
+	node->parent = parent;
+	node->x = x;
+	node->y = y;
+	node->f = f;
+
+	size_t slot = getNodeTableSlot(x, y);
+	while (nodeTable[slot] != 0) {
+		slot = (slot + 1) & (NODE_TABLE_SIZE - 1);
+	}
+	nodeTable[slot] = retNode + 1;
+
+	pushOpenEntry(retNode);
+	return node;
+}
+
+void AStarNodes::pushOpenEntry(size_t index)
+{
+	if (openEntryCount >= MAX_OPEN_ENTRIES) {
+		// drop the stale entries, every open node has exactly one valid entry
+		openEntryCount = 0;
+		for (size_t i = 0; i < curNode; ++i) {
+			if (openNodes[i] && i != index) {
+				openEntries[openEntryCount++] = {static_cast<int32_t>(nodes[i].f), static_cast<uint16_t>(i)};
+			}
+		}
+		std::make_heap(openEntries, openEntries + openEntryCount);
+	}
+
+	openEntries[openEntryCount++] = {static_cast<int32_t>(nodes[index].f), static_cast<uint16_t>(index)};
+	std::push_heap(openEntries, openEntries + openEntryCount);
+}
+
+AStarNode* AStarNodes::getBestNode()
+{
+	while (openEntryCount != 0) {
+		const OpenEntry& entry = openEntries[0];
+		if (openNodes[entry.index] && nodes[entry.index].f == entry.f) {
+			return &nodes[entry.index];
+		}
+
+		std::pop_heap(openEntries, openEntries + openEntryCount);
+		--openEntryCount;
+	}
+	return nullptr;
+}
+
+void AStarNodes::closeNode(AStarNode* node)
+{
+	openNodes[GET_NODE_INDEX(node)] = false;
+	++closedNodes;
+}
+
+void AStarNodes::openNode(AStarNode* node)
+{
+	size_t pos = GET_NODE_INDEX(node);
+	if (!openNodes[pos]) {
+		openNodes[pos] = true;
+		--closedNodes;
+	}
+
+	// the node either got reopened or cheaper, its older entries are stale now
+	pushOpenEntry(pos);
+}
+
+AStarNode* AStarNodes::getNodeByPosition(uint32_t x, uint32_t y)
+{
+	size_t slot = getNodeTableSlot(x, y);
+	while (uint16_t index = nodeTable[slot]) {
+		AStarNode* node = &nodes[index - 1];
+		if (node->x == x && node->y == y) {
+			return node;
+		}
+		slot = (slot + 1) & (NODE_TABLE_SIZE - 1);
+	}
+	return nullptr;
+}
+
+}
+
+// Map::getPathMatching with the tile lookups replaced by grid cells and the
+// path condition by reaching the target
+template<typename Nodes>
+static bool getPathMatching(const Grid& grid, Position pos, const Position& target, std::forward_list<Direction>& dirList, const FindPathParams& fpp)
+{
+	Position endPos;
+
+	Nodes nodes(pos.x, pos.y);
+
+	static int_fast32_t dirNeighbors[8][5][2] = {
+		{{-1, 0}, {0, 1}, {1, 0}, {1, 1}, {-1, 1}},
+		{{-1, 0}, {0, 1}, {0, -1}, {-1, -1}, {-1, 1}},
+		{{-1, 0}, {1, 0}, {0, -1}, {-1, -1}, {1, -1}},
+		{{0, 1}, {1, 0}, {0, -1}, {1, -1}, {1, 1}},
+		{{1, 0}, {0, -1}, {-1, -1}, {1, -1}, {1, 1}},
+		{{-1, 0}, {0, -1}, {-1, -1}, {1, -1}, {-1, 1}},
+		{{0, 1}, {1, 0}, {1, -1}, {1, 1}, {-1, 1}},
+		{{-1, 0}, {0, 1}, {-1, -1}, {1, 1}, {-1, 1}}
+	};
+	static int_fast32_t allNeighbors[8][2] = {
+		{-1, 0}, {0, 1}, {1, 0}, {0, -1}, {-1, -1}, {1, -1}, {1, 1}, {-1, 1}
+	};
+
+	const Position startPos = pos;
+
+	AStarNode* found = nullptr;
+	while (fpp.maxSearchDist != 0 || nodes.getClosedNodes() < 100) {
+		AStarNode* n = nodes.getBestNode();
+		if (!n) {
+			break;
+		}
+
+		const int_fast32_t x = n->x;
+		const int_fast32_t y = n->y;
+		if (x == target.x && y == target.y) {
+			found = n;
+			endPos.x = x;
+			endPos.y = y;
+			break;
+		}
+
+		uint_fast32_t dirCount;
+		int_fast32_t* neighbors;
+		if (n->parent) {
+			const int_fast32_t offset_x = n->parent->x - x;
+			const int_fast32_t offset_y = n->parent->y - y;
+			if (offset_y == 0) {
+				if (offset_x == -1) {
+					neighbors = *dirNeighbors[DIRECTION_WEST];
+				} else {
+					neighbors = *dirNeighbors[DIRECTION_EAST];
+				}
+			} else if (!fpp.allowDiagonal || offset_x == 0) {
+				if (offset_y == -1) {
+					neighbors = *dirNeighbors[DIRECTION_NORTH];
+				} else {
+					neighbors = *dirNeighbors[DIRECTION_SOUTH];
+				}
+			} else if (offset_y == -1) {
+				if (offset_x == -1) {
+					neighbors = *dirNeighbors[DIRECTION_NORTHWEST];
+				} else {
+					neighbors = *dirNeighbors[DIRECTION_NORTHEAST];
+				}
+			} else if (offset_x == -1) {
+				neighbors = *dirNeighbors[DIRECTION_SOUTHWEST];
+			} else {
+				neighbors = *dirNeighbors[DIRECTION_SOUTHEAST];
+			}
+			dirCount = fpp.allowDiagonal ? 5 : 3;
+		} else {
+			dirCount = 8;
+			neighbors = *allNeighbors;
+		}
+
+		const int_fast32_t f = n->f;
+		for (uint_fast32_t i = 0; i < dirCount; ++i) {
+			pos.x = x + *neighbors++;
+			pos.y = y + *neighbors++;
+
+			if (fpp.maxSearchDist != 0 && (std::abs(startPos.x - pos.x) > fpp.maxSearchDist || std::abs(startPos.y - pos.y) > fpp.maxSearchDist)) {
+				continue;
+			}
+
+			const int32_t* cell = grid.getCell(pos.x, pos.y);
+			AStarNode* neighborNode = nodes.getNodeByPosition(pos.x, pos.y);
+			if (!neighborNode && (!cell || *cell < 0)) {
+				continue;
+			}
+
+			//The cost (g) for this neighbor
+			const int_fast32_t cost = (std::abs(x - pos.x) == std::abs(y - pos.y)) ? MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST;
+			const int_fast32_t newf = f + cost + (cell ? std::max<int32_t>(*cell, 0) : 0);
+
+			if (neighborNode) {
+				if (neighborNode->f <= newf) {
+					//The node on the closed/open list is cheaper than this one
+					continue;
+				}
+
+				neighborNode->f = newf;
+				neighborNode->parent = n;
+				nodes.openNode(neighborNode);
+			} else {
+				//Does not exist in the open/closed list, create a new node
+				neighborNode = nodes.createOpenNode(n, pos.x, pos.y, newf);
+				if (!neighborNode) {
+					return false;
+				}
+			}
+		}
+
+		nodes.closeNode(n);
+	}
+
+	if (!found) {
+		return false;
+	}
+
+	int_fast32_t prevx = endPos.x;
+	int_fast32_t prevy = endPos.y;
+
+	found = found->parent;
+	while (found) {
+		int_fast32_t dx = found->x - prevx;
+		int_fast32_t dy = found->y - prevy;
+
+		prevx = found->x;
+		prevy = found->y;
+
+		if (dx == 1 && dy == 1) {
+			dirList.push_front(DIRECTION_NORTHWEST);
+		} else if (dx == -1 && dy == 1) {
+			dirList.push_front(DIRECTION_NORTHEAST);
+		} else if (dx == 1 && dy == -1) {
+			dirList.push_front(DIRECTION_SOUTHWEST);
+		} else if (dx == -1 && dy == -1) {
+			dirList.push_front(DIRECTION_SOUTHEAST);
+		} else if (dx == 1) {
+			dirList.push_front(DIRECTION_WEST);
+		} else if (dx == -1) {
+			dirList.push_front(DIRECTION_EAST);
+		} else if (dy == 1) {
+			dirList.push_front(DIRECTION_NORTH);
+		} else if (dy == -1) {
+			dirList.push_front(DIRECTION_SOUTH);
+		}
+
+		found = found->parent;
+	}
+	return true;
+}
+
+struct Search {
+	Grid* grid;
+	Position start, target;
+	FindPathParams fpp;
+};
+
+static double elapsedNs(std::chrono::steady_clock::time_point start, size_t iterations)
+{
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+template<typename Nodes>
+static double runSearches(const std::vector<Search>& searches, std::vector<std::forward_list<Direction>>& paths, size_t& found)
+{
+	const size_t rounds = 5;
+	found = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (size_t round = 0; round < rounds; ++round) {
+		for (size_t i = 0; i < searches.size(); ++i) {
+			const Search& search = searches[i];
+			paths[i].clear();
+			if (getPathMatching<Nodes>(*search.grid, search.start, search.target, paths[i], search.fpp)) {
+				++found;
+			}
+		}
+	}
+	found /= rounds;
+	return elapsedNs(start, rounds * searches.size());
+}
+
+// obstacles: chance in percent of a blocked cell, fields: chance of a cell
+// with an extra cost, targetDist: how far the target may be from the start
+static void benchmark(const char* name, uint32_t obstacles, uint32_t fields, int32_t targetDist, int32_t maxSearchDist)
+{
+	const size_t gridCount = 64;
+	const size_t searchCount = 4000;
+
+	std::mt19937 rng(42);
+
+	std::vector<Grid> grids(gridCount);
+	for (Grid& grid : grids) {
+		for (int32_t& cell : grid.cells) {
+			if (rng() % 100 < obstacles) {
+				cell = -1;
+			} else if (rng() % 100 < fields) {
+				cell = (rng() % 4 == 0) ? 180 : 30;
+			} else {
+				cell = 0;
+			}
+		}
+	}
+
+	std::vector<Search> searches(searchCount);
+	for (Search& search : searches) {
+		search.grid = &grids[rng() % gridCount];
+		search.start.x = GRID_BASE + GRID_SIZE / 2 - 8 + rng() % 16;
+		search.start.y = GRID_BASE + GRID_SIZE / 2 - 8 + rng() % 16;
+		search.target.x = search.start.x - targetDist + rng() % (2 * targetDist + 1);
+		search.target.y = search.start.y - targetDist + rng() % (2 * targetDist + 1);
+		search.fpp.allowDiagonal = rng() % 2 == 0;
+		search.fpp.maxSearchDist = maxSearchDist;
+
+		// the start is where the creature stands, it is always walkable
+		search.grid->cells[(search.start.y - GRID_BASE) * GRID_SIZE + search.start.x - GRID_BASE] = 0;
+	}
+
+	std::vector<std::forward_list<Direction>> oldPaths(searchCount), newPaths(searchCount);
+	size_t oldFound, newFound;
+	const double oldNs = runSearches<old_nodes::AStarNodes>(searches, oldPaths, oldFound);
+	const double newNs = runSearches<new_nodes::AStarNodes>(searches, newPaths, newFound);
+
+	size_t differing = 0;
+	for (size_t i = 0; i < searchCount; ++i) {
+		if (oldPaths[i] != newPaths[i]) {
+			++differing;
+		}
+	}
+
+	std::printf("%-22s %8zu %8zu %10zu %12.1f %12.1f\n", name, searchCount, oldFound, differing, oldNs, newNs);
+}
+
+int main()
+{
+	std::printf("%-22s %8s %8s %10s %12s %12s\n", "scenario", "searches", "found", "different", "old ns", "new ns");
+	benchmark("open, near", 0, 0, 4, 12);
+	benchmark("open, far", 0, 0, 12, 12);
+	benchmark("obstacles", 20, 0, 8, 12);
+	benchmark("obstacles, fields", 20, 15, 8, 12);
+	benchmark("maze", 40, 0, 8, 12);
+	benchmark("maze, no search limit", 40, 0, 8, 0);
+	benchmark("walled in", 70, 0, 8, 12);
+	return 0;
+}
@@ -0,0 +1,358 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2015  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Compares the spectator scan over one creature list per 8x8 block (all 16
+// floors together) with the scan over per floor lists that replaced it.
+// Both loops are the ones of Map::getSpectatorsInternal before and after
+// the change; the quadtree walk is replaced by a plain block array, which
+// costs both of them the same.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "spectators.h"
+
+#define MAP_MAX_LAYERS 16
+#define FLOOR_BITS 3
+#define FLOOR_SIZE (1 << FLOOR_BITS)
+#define FLOOR_MASK (FLOOR_SIZE - 1)
+
+#define WORLD_BLOCKS 128
+#define WORLD_SIZE (WORLD_BLOCKS * FLOOR_SIZE)
+
+static const int32_t maxViewportX = 11;
+static const int32_t maxViewportY = 11;
+
+struct Position {
+	uint16_t x, y;
+	uint8_t z;
+};
+
+// the real objects are large and spread over the heap, which is what the
+// per-creature position checks of the old loop pay for
+struct Creature {
+	Position position;
+	bool player;
+	char otherMembers[1024];
+
+	const Position& getPosition() const {
+		return position;
+	}
+};
+
+typedef std::vector<Creature*> CreatureVector;
+
+struct Floor {
+	void* tiles[FLOOR_SIZE][FLOOR_SIZE];
+	CreatureVector creatures;
+};
+
+struct Block {
+	// before: every creature of the block, whatever its floor
+	CreatureVector creature_list;
+	// after: one list per floor that has tiles in this block
+	std::unique_ptr<Floor> floors[MAP_MAX_LAYERS];
+	uint16_t creatureFloors;
+
+	const Floor* getFloor(int32_t z) const {
+		return floors[z].get();
+	}
+};
+
+static std::vector<Block> blocks(WORLD_BLOCKS * WORLD_BLOCKS);
+
+static const Block* getBlock(int32_t x, int32_t y)
+{
+	if (x < 0 || y < 0 || x >= WORLD_SIZE || y >= WORLD_SIZE) {
+		return nullptr;
+	}
+	return &blocks[(y >> FLOOR_BITS) * WORLD_BLOCKS + (x >> FLOOR_BITS)];
+}
+
+static void getSpectatorFloors(const Position& centerPos, int32_t& minRangeZ, int32_t& maxRangeZ)
+{
+	if (centerPos.z > 7) {
+		minRangeZ = std::max<int32_t>(centerPos.z - 2, 0);
+		maxRangeZ = std::min<int32_t>(centerPos.z + 2, MAP_MAX_LAYERS - 1);
+	} else if (centerPos.z == 6) {
+		minRangeZ = 0;
+		maxRangeZ = 8;
+	} else if (centerPos.z == 7) {
+		minRangeZ = 0;
+		maxRangeZ = 9;
+	} else {
+		minRangeZ = 0;
+		maxRangeZ = 7;
+	}
+}
+
+static void getBlockRange(const Position& centerPos, int32_t minRangeZ, int32_t maxRangeZ,
+                          int32_t& startx1, int32_t& starty1, int32_t& endx2, int32_t& endy2)
+{
+	int32_t minoffset = centerPos.z - maxRangeZ;
+	uint16_t x1 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, (centerPos.x - maxViewportX + minoffset)));
+	uint16_t y1 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, (centerPos.y - maxViewportY + minoffset)));
+
+	int32_t maxoffset = centerPos.z - minRangeZ;
+	uint16_t x2 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, (centerPos.x + maxViewportX + maxoffset)));
+	uint16_t y2 = std::min<uint32_t>(0xFFFF, std::max<int32_t>(0, (centerPos.y + maxViewportY + maxoffset)));
+
+	startx1 = x1 - (x1 % FLOOR_SIZE);
+	starty1 = y1 - (y1 % FLOOR_SIZE);
+	endx2 = x2 - (x2 % FLOOR_SIZE);
+	endy2 = y2 - (y2 % FLOOR_SIZE);
+}
+
+static void getSpectatorsOld(SpectatorVec& list, const Position& centerPos)
+{
+	int32_t minRangeZ, maxRangeZ;
+	getSpectatorFloors(centerPos, minRangeZ, maxRangeZ);
+
+	int_fast16_t min_y = centerPos.y - maxViewportY;
+	int_fast16_t min_x = centerPos.x - maxViewportX;
+	int_fast16_t max_y = centerPos.y + maxViewportY;
+	int_fast16_t max_x = centerPos.x + maxViewportX;
+
+	int32_t startx1, starty1, endx2, endy2;
+	getBlockRange(centerPos, minRangeZ, maxRangeZ, startx1, starty1, endx2, endy2);
+
+	for (int_fast32_t ny = starty1; ny <= endy2; ny += FLOOR_SIZE) {
+		for (int_fast32_t nx = startx1; nx <= endx2; nx += FLOOR_SIZE) {
+			const Block* block = getBlock(nx, ny);
+			if (!block) {
+				continue;
+			}
+
+			for (Creature* creature : block->creature_list) {
+				const Position& cpos = creature->getPosition();
+				if (cpos.z < minRangeZ || cpos.z > maxRangeZ) {
+					continue;
+				}
+
+				int_fast16_t offsetZ = centerPos.z - cpos.z;
+				if (cpos.y < (min_y + offsetZ) || cpos.y > (max_y + offsetZ)) {
+					continue;
+				}
+
+				if (cpos.x < (min_x + offsetZ) || cpos.x > (max_x + offsetZ)) {
+					continue;
+				}
+
+				list.emplace_back(creature);
+			}
+		}
+	}
+}
+
+static void getSpectatorsNew(SpectatorVec& list, const Position& centerPos)
+{
+	int32_t minRangeZ, maxRangeZ;
+	getSpectatorFloors(centerPos, minRangeZ, maxRangeZ);
+
+	int_fast16_t min_y = centerPos.y - maxViewportY;
+	int_fast16_t min_x = centerPos.x - maxViewportX;
+	int_fast16_t max_y = centerPos.y + maxViewportY;
+	int_fast16_t max_x = centerPos.x + maxViewportX;
+
+	int32_t startx1, starty1, endx2, endy2;
+	getBlockRange(centerPos, minRangeZ, maxRangeZ, startx1, starty1, endx2, endy2);
+
+	const uint32_t floorRange = ((1 << (maxRangeZ + 1)) - 1) & ~((1 << minRangeZ) - 1);
+
+	for (int_fast32_t ny = starty1; ny <= endy2; ny += FLOOR_SIZE) {
+		for (int_fast32_t nx = startx1; nx <= endx2; nx += FLOOR_SIZE) {
+			const Block* block = getBlock(nx, ny);
+			if (!block) {
+				continue;
+			}
+
+			const uint32_t floors = block->creatureFloors & floorRange;
+			for (int32_t nz = minRangeZ; floors != 0 && nz <= maxRangeZ; ++nz) {
+				if ((floors & (1 << nz)) == 0) {
+					continue;
+				}
+
+				int_fast32_t offsetZ = centerPos.z - nz;
+				int_fast32_t floorMinX = min_x + offsetZ;
+				int_fast32_t floorMaxX = max_x + offsetZ;
+				int_fast32_t floorMinY = min_y + offsetZ;
+				int_fast32_t floorMaxY = max_y + offsetZ;
+				if (nx > floorMaxX || nx + FLOOR_MASK < floorMinX || ny > floorMaxY || ny + FLOOR_MASK < floorMinY) {
+					continue;
+				}
+
+				const CreatureVector& floor_list = block->getFloor(nz)->creatures;
+				if (floor_list.empty()) {
+					continue;
+				}
+
+				if (nx >= floorMinX && nx + FLOOR_MASK <= floorMaxX && ny >= floorMinY && ny + FLOOR_MASK <= floorMaxY) {
+					for (Creature* creature : floor_list) {
+						list.emplace_back(creature);
+					}
+					continue;
+				}
+
+				for (Creature* creature : floor_list) {
+					const Position& cpos = creature->getPosition();
+					if (cpos.x >= floorMinX && cpos.x <= floorMaxX && cpos.y >= floorMinY && cpos.y <= floorMaxY) {
+						list.emplace_back(creature);
+					}
+				}
+			}
+		}
+	}
+}
+
+static void buildFloors()
+{
+	std::mt19937 rng(42);
+
+	// the surface exists everywhere, caves under 40% and buildings above
+	// 10% of the blocks
+	for (Block& block : blocks) {
+		block.floors[7].reset(new Floor);
+		bool cave = rng() % 10 < 4;
+		bool building = rng() % 10 == 0;
+		for (int32_t z = 0; z < MAP_MAX_LAYERS; ++z) {
+			if ((z > 7 && z <= 12 && cave) || (z < 7 && z >= 4 && building)) {
+				block.floors[z].reset(new Floor);
+			}
+		}
+	}
+}
+
+// creatures crowd on the surface, the rest is spread over the floors that
+// exist where they stand; either one by one or in spawns of eight
+static int run(size_t creatureCount, bool spawns)
+{
+	std::mt19937 rng(creatureCount);
+	std::vector<std::unique_ptr<Creature>> creatures;
+	for (size_t i = 0; i < creatureCount; ++i) {
+		creatures.emplace_back(new Creature);
+	}
+	std::shuffle(creatures.begin(), creatures.end(), rng);
+
+	for (Block& block : blocks) {
+		block.creature_list.clear();
+		block.creatureFloors = 0;
+		for (auto& floor : block.floors) {
+			if (floor) {
+				floor->creatures.clear();
+			}
+		}
+	}
+
+	Position spawnPos = {0, 0, 0};
+	for (size_t i = 0; i < creatureCount; ++i) {
+		Creature& creature = *creatures[i];
+		bool newSpawn = !spawns || i % 8 == 0;
+		for (;;) {
+			if (newSpawn) {
+				spawnPos.x = 4 + rng() % (WORLD_SIZE - 8);
+				spawnPos.y = 4 + rng() % (WORLD_SIZE - 8);
+				spawnPos.z = rng() % 10 < 7 ? 7 : rng() % MAP_MAX_LAYERS;
+			}
+
+			Position pos = spawnPos;
+			if (spawns) {
+				pos.x += static_cast<int32_t>(rng() % 9) - 4;
+				pos.y += static_cast<int32_t>(rng() % 9) - 4;
+			}
+
+			Block& block = blocks[(pos.y >> FLOOR_BITS) * WORLD_BLOCKS + (pos.x >> FLOOR_BITS)];
+			if (!block.floors[pos.z]) {
+				newSpawn = true;
+				continue;
+			}
+
+			creature.position = pos;
+			creature.player = rng() % 10 == 0;
+			block.creature_list.push_back(&creature);
+			block.floors[pos.z]->creatures.push_back(&creature);
+			block.creatureFloors |= 1 << pos.z;
+			break;
+		}
+	}
+
+	// spectator queries are made around creatures
+	const size_t queryCount = 200000;
+	std::vector<Position> queries;
+	for (size_t i = 0; i < queryCount; ++i) {
+		queries.push_back(creatures[rng() % creatureCount]->position);
+	}
+
+	size_t found = 0;
+	for (const Position& pos : queries) {
+		SpectatorVec oldList, newList;
+		getSpectatorsOld(oldList, pos);
+		getSpectatorsNew(newList, pos);
+
+		std::vector<Creature*> oldSorted(oldList.begin(), oldList.end());
+		std::vector<Creature*> newSorted(newList.begin(), newList.end());
+		std::sort(oldSorted.begin(), oldSorted.end());
+		std::sort(newSorted.begin(), newSorted.end());
+		if (oldSorted != newSorted) {
+			std::printf("spectators around %d,%d,%d differ\n", pos.x, pos.y, pos.z);
+			return 1;
+		}
+		found += oldList.size();
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	size_t sink = 0;
+	for (const Position& pos : queries) {
+		SpectatorVec list;
+		getSpectatorsOld(list, pos);
+		sink += list.size();
+	}
+	double oldNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / queryCount;
+
+	start = std::chrono::steady_clock::now();
+	for (const Position& pos : queries) {
+		SpectatorVec list;
+		getSpectatorsNew(list, pos);
+		sink -= list.size();
+	}
+	double newNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / queryCount;
+
+	std::printf("%10s %10zu %14.1f %14.1f %14.1f\n", spawns ? "spawns" : "scattered", creatureCount, static_cast<double>(found) / queryCount, oldNs, newNs);
+	return sink != 0;
+}
+
+int main()
+{
+	buildFloors();
+
+	std::printf("%10s %10s %14s %14s %14s\n", "placement", "creatures", "spectators", "per block ns", "per floor ns");
+	for (bool spawns : {false, true}) {
+		for (size_t creatureCount : {10000, 30000, 100000, 300000}) {
+			if (run(creatureCount, spawns) != 0) {
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
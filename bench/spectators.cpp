@@ -0,0 +1,162 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2015  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Compares SpectatorVec with the std::unordered_set<Creature*> it replaced,
+// for the way spectator lists are used: filled once by a map scan, walked
+// once, and now and then merged with a second list (Map::moveCreature).
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+#include "spectators.h"
+
+struct Creature {
+	uint32_t id;
+};
+
+typedef std::unordered_set<Creature*> OldSpectatorVec;
+
+static Creature creatures[4096];
+
+static double elapsedNs(std::chrono::steady_clock::time_point start, size_t iterations)
+{
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+template<typename List>
+static uint64_t sumIds(const List& list)
+{
+	uint64_t sum = 0;
+	for (Creature* creature : list) {
+		sum += creature->id;
+	}
+	return sum;
+}
+
+static void fillOld(OldSpectatorVec& list, const std::vector<Creature*>& found)
+{
+	for (Creature* creature : found) {
+		list.insert(creature);
+	}
+}
+
+static void fillNew(SpectatorVec& list, const std::vector<Creature*>& found)
+{
+	// a scan never returns a creature twice, see Map::getSpectatorsInternal
+	for (Creature* creature : found) {
+		list.emplace_back(creature);
+	}
+}
+
+template<typename List>
+static bool sameCreatures(const List& list, const std::set<Creature*>& expected)
+{
+	return list.size() == expected.size() && std::set<Creature*>(list.begin(), list.end()) == expected;
+}
+
+int main()
+{
+	for (uint32_t i = 0; i < 4096; ++i) {
+		creatures[i].id = i;
+	}
+
+	std::mt19937 rng(42);
+	const size_t iterations = 200000;
+	volatile uint64_t sink = 0;
+
+	std::printf("%10s %14s %14s %14s %14s\n", "spectators", "old scan ns", "new scan ns", "old merge ns", "new merge ns");
+	for (size_t count : {4, 16, 48, 150, 400}) {
+		// distinct creatures for one scan, and a second overlapping scan
+		std::vector<Creature*> pool;
+		for (Creature& creature : creatures) {
+			pool.push_back(&creature);
+		}
+		std::shuffle(pool.begin(), pool.end(), rng);
+		std::vector<Creature*> first(pool.begin(), pool.begin() + count);
+		std::vector<Creature*> second(pool.begin() + count / 2, pool.begin() + count / 2 + count);
+
+		std::set<Creature*> expected(first.begin(), first.end());
+		std::set<Creature*> expectedMerged(expected);
+		expectedMerged.insert(second.begin(), second.end());
+
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < iterations; ++i) {
+			OldSpectatorVec list;
+			fillOld(list, first);
+			sink += sumIds(list);
+		}
+		double oldScan = elapsedNs(start, iterations);
+
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < iterations; ++i) {
+			SpectatorVec list;
+			fillNew(list, first);
+			sink += sumIds(list);
+		}
+		double newScan = elapsedNs(start, iterations);
+
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < iterations; ++i) {
+			OldSpectatorVec list, other;
+			fillOld(list, first);
+			fillOld(other, second);
+			list.insert(other.begin(), other.end());
+			sink += sumIds(list);
+		}
+		double oldMerge = elapsedNs(start, iterations);
+
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < iterations; ++i) {
+			SpectatorVec list, other;
+			fillNew(list, first);
+			fillNew(other, second);
+			list.addSpectators(other);
+			sink += sumIds(list);
+		}
+		double newMerge = elapsedNs(start, iterations);
+
+		OldSpectatorVec oldList, oldOther;
+		fillOld(oldList, first);
+		fillOld(oldOther, second);
+		oldList.insert(oldOther.begin(), oldOther.end());
+
+		SpectatorVec newList, newOther;
+		fillNew(newList, first);
+		fillNew(newOther, second);
+		if (!sameCreatures(newList, expected)) {
+			std::printf("scan of %zu spectators differs\n", count);
+			return 1;
+		}
+		newList.addSpectators(newOther);
+		if (!sameCreatures(newList, expectedMerged) || !sameCreatures(oldList, expectedMerged)) {
+			std::printf("merge of %zu spectators differs\n", count);
+			return 1;
+		}
+
+		std::printf("%10zu %14.1f %14.1f %14.1f %14.1f\n", count, oldScan, newScan, oldMerge, newMerge);
+	}
+	return sink == 0;
+}
@@ -100,6 +100,12 @@ convertUnsafeScripts = true
 defaultPriority = "high"
 startupDatabaseOptimization = false
 
+-- Threads
+-- NOTE: workerThreads are used to spread heavy read-only work (such as
+-- monster path finding) over multiple cores, set it to -1 to use one
+-- thread per core or to 0 to do everything on the main thread
+workerThreads = -1
+
 -- Status server information
 ownerName = ""
 ownerEmail = ""
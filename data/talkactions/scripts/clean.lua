@@ -7,9 +7,9 @@ function onSay(player, words, param)
 		return false
 	end
 
-	local itemCount = cleanMap()
-	if itemCount > 0 then
-		player:sendTextMessage(MESSAGE_STATUS_WARNING, "Cleaned " .. itemCount .. " item" .. (itemCount > 1 and "s" or "") .. " from the map.")
+	local tileCount = cleanMap()
+	if tileCount > 0 then
+		player:sendTextMessage(MESSAGE_STATUS_WARNING, "Cleaning " .. tileCount .. " tile" .. (tileCount > 1 and "s" or "") .. " of the map.")
 	end
 	return false
 end
@@ -44,11 +44,9 @@ Attr_ReadValue BedItem::readAttr(AttrTypes_t attr, PropStream& propStream)
 			}
 
 			if (guid != 0) {
-				std::string name = IOLoginData::getNameByGuid(guid);
-				if (!name.empty()) {
-					setSpecialDescription(name + " is sleeping there.");
-					g_game.setBedSleeper(this, guid);
-					sleeperGUID = guid;
+				sleeperGUID = guid;
+				if (!Item::deferRegistration) {
+					registerSleeper();
 				}
 			}
 			return ATTR_READ_CONTINUE;
@@ -84,6 +82,18 @@ void BedItem::serializeAttr(PropWriteStream& propWriteStream) const
 	}
 }
 
+void BedItem::registerSleeper()
+{
+	std::string name = IOLoginData::getNameByGuid(sleeperGUID);
+	if (name.empty()) {
+		sleeperGUID = 0;
+		return;
+	}
+
+	setSpecialDescription(name + " is sleeping there.");
+	g_game.setBedSleeper(this, sleeperGUID);
+}
+
 BedItem* BedItem::getNextBedItem() const
 {
 	Direction dir = Item::items[id].bedPartnerDir;
@@ -270,6 +280,10 @@ void BedItem::internalSetSleeper(const Player* player)
 	sleeperGUID = player->getGUID();
 	sleepStart = time(nullptr);
 	setSpecialDescription(desc_str);
+
+	if (house) {
+		house->setItemsChanged(true);
+	}
 }
 
 void BedItem::internalRemoveSleeper()
@@ -277,4 +291,8 @@ void BedItem::internalRemoveSleeper()
 	sleeperGUID = 0;
 	sleepStart = 0;
 	setSpecialDescription("Nobody is sleeping there.");
+
+	if (house) {
+		house->setItemsChanged(true);
+	}
 }
@@ -59,6 +59,8 @@ class BedItem final : public Item
 			house = h;
 		}
 
+		void registerSleeper();
+
 		bool canUse(Player* player);
 
 		bool trySleep(Player* player);
@@ -0,0 +1,109 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2015  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_CHUNKPOOL_H_7C1A3E5F0B9D4C2A8E6F1D3B5A7C9E0F
+#define FS_CHUNKPOOL_H_7C1A3E5F0B9D4C2A8E6F1D3B5A7C9E0F
+
+// Hands out small objects from large chunks, with a free list per size so
+// freed memory is reused by the next object of that size. Chunks are never
+// given back, so this is for objects that are allocated by the million and
+// live about as long as the server does.
+class ChunkPool
+{
+	public:
+		ChunkPool() : freeLists(), chunkUsed(CHUNK_SIZE), allocatedBytes(0), usedBytes(0) {}
+
+		void* allocate(size_t size) {
+			size_t slot = getSlot(size);
+			if (slot >= SLOT_COUNT) {
+				return ::operator new(size);
+			}
+
+			std::lock_guard<std::mutex> lockGuard(lock);
+			usedBytes += slot * ALIGNMENT;
+
+			FreeNode* node = freeLists[slot];
+			if (node) {
+				freeLists[slot] = node->next;
+				return node;
+			}
+
+			size = slot * ALIGNMENT;
+			if (chunkUsed + size > CHUNK_SIZE) {
+				chunks.emplace_back(new char[CHUNK_SIZE]);
+				allocatedBytes += CHUNK_SIZE;
+				chunkUsed = 0;
+			}
+
+			void* p = chunks.back().get() + chunkUsed;
+			chunkUsed += size;
+			return p;
+		}
+
+		void deallocate(void* p, size_t size) {
+			if (!p) {
+				return;
+			}
+
+			size_t slot = getSlot(size);
+			if (slot >= SLOT_COUNT) {
+				::operator delete(p);
+				return;
+			}
+
+			std::lock_guard<std::mutex> lockGuard(lock);
+			usedBytes -= slot * ALIGNMENT;
+
+			FreeNode* node = static_cast<FreeNode*>(p);
+			node->next = freeLists[slot];
+			freeLists[slot] = node;
+		}
+
+		size_t getAllocatedBytes() {
+			std::lock_guard<std::mutex> lockGuard(lock);
+			return allocatedBytes;
+		}
+
+		size_t getUsedBytes() {
+			std::lock_guard<std::mutex> lockGuard(lock);
+			return usedBytes;
+		}
+
+	private:
+		static const size_t CHUNK_SIZE = 1 << 20;
+		static const size_t ALIGNMENT = sizeof(void*);
+		static const size_t SLOT_COUNT = 256 / ALIGNMENT + 1;
+
+		static size_t getSlot(size_t size) {
+			return (size + ALIGNMENT - 1) / ALIGNMENT;
+		}
+
+		struct FreeNode {
+			FreeNode* next;
+		};
+
+		std::mutex lock;
+		std::vector<std::unique_ptr<char[]>> chunks;
+		FreeNode* freeLists[SLOT_COUNT];
+		size_t chunkUsed;
+		size_t allocatedBytes;
+		size_t usedBytes;
+};
+
+#endif
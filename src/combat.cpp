@@ -107,7 +107,7 @@ CombatDamage Combat::getCombatDamage(Creature* creature, Creature* target) const
 	return damage;
 }
 
-void Combat::getCombatArea(const Position& centerPos, const Position& targetPos, const AreaCombat* area, std::forward_list<Tile*>& list)
+void Combat::getCombatArea(const Position& centerPos, const Position& targetPos, const AreaCombat* area, std::vector<Tile*>& list)
 {
 	if (targetPos.z >= MAP_MAX_LAYERS) {
 		return;
@@ -121,7 +121,7 @@ void Combat::getCombatArea(const Position& centerPos, const Position& targetPos,
 			tile = new StaticTile(targetPos.x, targetPos.y, targetPos.z);
 			g_game.map.setTile(targetPos, tile);
 		}
-		list.push_front(tile);
+		list.push_back(tile);
 	}
 }
 
@@ -255,7 +255,7 @@ ReturnValue Combat::canTargetCreature(Player* player, Creature* target)
 
 ReturnValue Combat::canDoCombat(Creature* caster, Tile* tile, bool aggressive)
 {
-	if (tile->hasProperty(CONST_PROP_BLOCKPROJECTILE)) {
+	if (tile->hasFlag(TILESTATE_BLOCKPROJECTILE)) {
 		return RETURNVALUE_NOTENOUGHROOM;
 	}
 
@@ -648,10 +648,6 @@ void Combat::combatTileEffects(const SpectatorVec& list, Creature* caster, Tile*
 	if (params.tileCallback) {
 		params.tileCallback->onTileCombat(caster, tile);
 	}
-
-	if (params.impactEffect != CONST_ME_NONE) {
-		Game::addMagicEffect(list, tile->getPosition(), params.impactEffect);
-	}
 }
 
 void Combat::postCombatEffects(Creature* caster, const Position& pos, const CombatParams& params)
@@ -696,7 +692,7 @@ void Combat::addDistanceEffect(Creature* caster, const Position& fromPos, const
 
 void Combat::CombatFunc(Creature* caster, const Position& pos, const AreaCombat* area, const CombatParams& params, COMBATFUNC func, void* data)
 {
-	std::forward_list<Tile*> tileList;
+	std::vector<Tile*> tileList;
 
 	if (caster) {
 		getCombatArea(caster->getPosition(), pos, area, tileList);
@@ -727,6 +723,12 @@ void Combat::CombatFunc(Creature* caster, const Position& pos, const AreaCombat*
 	const int32_t rangeY = maxY + Map::maxViewportY;
 	g_game.map.getSpectators(list, pos, true, true, rangeX, rangeX, rangeY, rangeY);
 
+	// the impact effects go out in one batch per spectator once the area is done
+	std::vector<Position> effectPositions;
+	if (params.impactEffect != CONST_ME_NONE) {
+		effectPositions.reserve(tileList.size());
+	}
+
 	for (Tile* tile : tileList) {
 		if (canDoCombat(caster, tile, params.aggressive) != RETURNVALUE_NOERROR) {
 			continue;
@@ -758,6 +760,14 @@ void Combat::CombatFunc(Creature* caster, const Position& pos, const AreaCombat*
 			}
 		}
 		combatTileEffects(list, caster, tile, params);
+
+		if (params.impactEffect != CONST_ME_NONE) {
+			effectPositions.push_back(tile->getPosition());
+		}
+	}
+
+	if (!effectPositions.empty()) {
+		Game::addMagicEffect(list, effectPositions, params.impactEffect);
 	}
 	postCombatEffects(caster, pos, params);
 }
@@ -897,6 +907,10 @@ void Combat::doCombatDefault(Creature* caster, Creature* target, const CombatPar
 		CombatNullFunc(caster, target, params, nullptr);
 		combatTileEffects(list, caster, target->getTile(), params);
 
+		if (params.impactEffect != CONST_ME_NONE) {
+			Game::addMagicEffect(list, target->getPosition(), params.impactEffect);
+		}
+
 		if (params.targetCallback) {
 			params.targetCallback->onTargetCombat(caster, target);
 		}
@@ -1098,34 +1112,45 @@ AreaCombat::AreaCombat(const AreaCombat& rhs)
 	}
 }
 
-void AreaCombat::getList(const Position& centerPos, const Position& targetPos, std::forward_list<Tile*>& list) const
+void AreaCombat::getList(const Position& centerPos, const Position& targetPos, std::vector<Tile*>& list) const
 {
 	const MatrixArea* area = getArea(centerPos, targetPos);
 	if (!area) {
 		return;
 	}
 
-	uint32_t centerY, centerX;
-	area->getCenter(centerY, centerX);
+	const std::vector<MatrixArea::Offset>& offsets = area->getOffsets();
+	list.reserve(list.size() + offsets.size());
+	for (const MatrixArea::Offset& offset : offsets) {
+		int32_t x = targetPos.x + offset.x;
+		int32_t y = targetPos.y + offset.y;
+		if (x < 0 || x > 0xFFFF || y < 0 || y > 0xFFFF) {
+			continue;
+		}
+
+		Position tmpPos(x, y, targetPos.z);
+		if (!g_game.isSightClear(targetPos, tmpPos, true)) {
+			continue;
+		}
 
-	Position tmpPos(targetPos.x - centerX, targetPos.y - centerY, targetPos.z);
-	uint32_t cols = area->getCols();
-	for (uint32_t y = 0, rows = area->getRows(); y < rows; ++y) {
+		Tile* tile = g_game.map.getTile(tmpPos);
+		if (!tile) {
+			tile = new StaticTile(tmpPos.x, tmpPos.y, tmpPos.z);
+			g_game.map.setTile(tmpPos, tile);
+		}
+		list.push_back(tile);
+	}
+}
+
+void MatrixArea::buildOffsets()
+{
+	offsets.clear();
+	for (uint32_t y = 0; y < rows; ++y) {
 		for (uint32_t x = 0; x < cols; ++x) {
-			if (area->getValue(y, x) != 0) {
-				if (g_game.isSightClear(targetPos, tmpPos, true)) {
-					Tile* tile = g_game.map.getTile(tmpPos);
-					if (!tile) {
-						tile = new StaticTile(tmpPos.x, tmpPos.y, tmpPos.z);
-						g_game.map.setTile(tmpPos, tile);
-					}
-					list.push_front(tile);
-				}
+			if (data_[y][x]) {
+				offsets.push_back({static_cast<int32_t>(x) - static_cast<int32_t>(centerX), static_cast<int32_t>(y) - static_cast<int32_t>(centerY)});
 			}
-			tmpPos.x++;
 		}
-		tmpPos.x -= cols;
-		tmpPos.y++;
 	}
 }
 
@@ -1267,6 +1292,11 @@ void AreaCombat::setupArea(const std::list<uint32_t>& list, uint32_t rows)
 	MatrixArea* westArea = new MatrixArea(maxOutput, maxOutput);
 	copyArea(area, westArea, MATRIXOPERATION_ROTATE270);
 	areas[DIRECTION_WEST] = westArea;
+
+	area->buildOffsets();
+	southArea->buildOffsets();
+	eastArea->buildOffsets();
+	westArea->buildOffsets();
 }
 
 void AreaCombat::setupArea(int32_t length, int32_t spread)
@@ -1367,6 +1397,11 @@ void AreaCombat::setupExtArea(const std::list<uint32_t>& list, uint32_t rows)
 	MatrixArea* seArea = new MatrixArea(maxOutput, maxOutput);
 	copyArea(swArea, seArea, MATRIXOPERATION_MIRROR);
 	areas[DIRECTION_SOUTHEAST] = seArea;
+
+	area->buildOffsets();
+	neArea->buildOffsets();
+	swArea->buildOffsets();
+	seArea->buildOffsets();
 }
 
 //**********************************************************//
@@ -128,7 +128,7 @@ class MatrixArea
 			}
 		}
 
-		MatrixArea(const MatrixArea& rhs) {
+		MatrixArea(const MatrixArea& rhs) : offsets(rhs.offsets) {
 			centerX = rhs.centerX;
 			centerY = rhs.centerY;
 			rows = rhs.rows;
@@ -186,7 +186,20 @@ class MatrixArea
 			return data_[i];
 		}
 
+		struct Offset {
+			int32_t x;
+			int32_t y;
+		};
+
+		//the marked cells relative to the center, so that casting does not have to walk the matrix
+		void buildOffsets();
+		const std::vector<Offset>& getOffsets() const {
+			return offsets;
+		}
+
 	protected:
+		std::vector<Offset> offsets;
+
 		uint32_t centerX;
 		uint32_t centerY;
 
@@ -210,7 +223,7 @@ class AreaCombat
 		AreaCombat& operator=(const AreaCombat&) = delete;
 
 		ReturnValue doCombat(Creature* attacker, const Position& pos, const Combat& combat) const;
-		void getList(const Position& centerPos, const Position& targetPos, std::forward_list<Tile*>& list) const;
+		void getList(const Position& centerPos, const Position& targetPos, std::vector<Tile*>& list) const;
 
 		void setupArea(const std::list<uint32_t>& list, uint32_t rows);
 		void setupArea(int32_t length, int32_t spread);
@@ -291,7 +304,7 @@ class Combat
 		static void doCombatDispel(Creature* caster, Creature* target, const CombatParams& params);
 		static void doCombatDispel(Creature* caster, const Position& position, const AreaCombat* area, const CombatParams& params);
 
-		static void getCombatArea(const Position& centerPos, const Position& targetPos, const AreaCombat* area, std::forward_list<Tile*>& list);
+		static void getCombatArea(const Position& centerPos, const Position& targetPos, const AreaCombat* area, std::vector<Tile*>& list);
 
 		static bool isInPvpZone(const Creature* attacker, const Creature* target);
 		static bool isProtected(const Player* attacker, const Player* target);
@@ -134,7 +134,7 @@ void Condition::serialize(PropWriteStream& propWriteStream)
 	propWriteStream.write<uint32_t>(id);
 
 	propWriteStream.write<uint8_t>(CONDITIONATTR_TICKS);
-	propWriteStream.write<uint32_t>(ticks);
+	propWriteStream.write<uint32_t>(getTicks());
 
 	propWriteStream.write<uint8_t>(CONDITIONATTR_ISBUFF);
 	propWriteStream.write<uint8_t>(isBuff);
@@ -143,6 +143,16 @@ void Condition::serialize(PropWriteStream& propWriteStream)
 	propWriteStream.write<uint32_t>(subId);
 }
 
+int32_t Condition::getTicks() const
+{
+	//non-periodic conditions are not executed until they expire, so their
+	//ticks are only brought up to date here
+	if (ticks <= 0 || endTime == 0 || endTime == std::numeric_limits<int64_t>::max() || isPeriodic()) {
+		return ticks;
+	}
+	return static_cast<int32_t>(std::max<int64_t>(0, endTime - OTSYS_TIME()));
+}
+
 void Condition::setTicks(int32_t newTicks)
 {
 	ticks = newTicks;
@@ -78,6 +78,13 @@ class Condition
 		virtual void endCondition(Creature* creature) = 0;
 		virtual void addCondition(Creature* creature, const Condition* condition) = 0;
 		virtual uint32_t getIcons() const;
+
+		//conditions that do work between start and end (damage, regeneration, ...);
+		//the others only need to be looked at again once they expire
+		virtual bool isPeriodic() const {
+			return false;
+		}
+
 		ConditionId_t getId() const {
 			return id;
 		}
@@ -93,9 +100,7 @@ class Condition
 		int64_t getEndTime() const {
 			return endTime;
 		}
-		int32_t getTicks() const {
-			return ticks;
-		}
+		int32_t getTicks() const;
 		void setTicks(int32_t newTicks);
 
 		static Condition* createCondition(ConditionId_t _id, ConditionType_t _type, int32_t ticks, int32_t param = 0, bool _buff = false, uint32_t _subId = 0);
@@ -178,6 +183,9 @@ class ConditionRegeneration final : public ConditionGeneric
 
 		void addCondition(Creature* creature, const Condition* addCondition) final;
 		bool executeCondition(Creature* creature, int32_t interval) final;
+		bool isPeriodic() const final {
+			return true;
+		}
 
 		bool setParam(ConditionParam_t param, int32_t value) final;
 
@@ -206,6 +214,9 @@ class ConditionSoul final : public ConditionGeneric
 
 		void addCondition(Creature* creature, const Condition* addCondition) final;
 		bool executeCondition(Creature* creature, int32_t interval) final;
+		bool isPeriodic() const final {
+			return true;
+		}
 
 		bool setParam(ConditionParam_t param, int32_t value) final;
 
@@ -246,6 +257,9 @@ class ConditionDamage final : public Condition
 
 		bool startCondition(Creature* creature) final;
 		bool executeCondition(Creature* creature, int32_t interval) final;
+		bool isPeriodic() const final {
+			return true;
+		}
 		void endCondition(Creature* creature) final;
 		void addCondition(Creature* creature, const Condition* condition) final;
 		uint32_t getIcons() const final;
@@ -357,6 +371,9 @@ class ConditionLight final : public Condition
 
 		bool startCondition(Creature* creature) final;
 		bool executeCondition(Creature* creature, int32_t interval) final;
+		bool isPeriodic() const final {
+			return true;
+		}
 		void endCondition(Creature* creature) final;
 		void addCondition(Creature* creature, const Condition* addCondition) final;
 
@@ -105,6 +105,7 @@ class ConfigManager
 			EXP_FROM_PLAYERS_LEVEL_RANGE,
 			MAX_PACKETS_PER_SECOND,
 			LIVE_CAST_PORT,
+			WORKER_THREADS,
 
 			LAST_INTEGER_CONFIG /* this must be the last one */
 		};
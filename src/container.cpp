@@ -52,6 +52,7 @@ Container::Container(Tile* tile) : Item(ITEM_BROWSEFIELD)
 			if (item->getContainer() || item->hasProperty(CONST_PROP_MOVEABLE)) {
 				itemlist.push_front(item);
 				item->setParent(this);
+				addItemTypeCounts(item);
 			}
 		}
 	}
@@ -87,6 +88,7 @@ Item* Container::clone() const
 		clone->addItem(item->clone());
 	}
 	clone->totalWeight = totalWeight;
+	clone->itemTypeCounts = itemTypeCounts;
 	return clone;
 }
 
@@ -153,6 +155,7 @@ bool Container::unserializeItemNode(FileLoader& f, NODE node, PropStream& propSt
 
 		addItem(item);
 		updateItemWeight(item->getWeight());
+		addItemTypeCounts(item);
 
 		nodeItem = f.getNextNode(nodeItem, type);
 	}
@@ -167,6 +170,60 @@ void Container::updateItemWeight(int32_t diff)
 	}
 }
 
+void Container::updateItemTypeCount(uint16_t itemId, int32_t diff)
+{
+	if (diff == 0) {
+		return;
+	}
+
+	auto it = itemTypeCounts.find(itemId);
+	if (it == itemTypeCounts.end()) {
+		assert(diff > 0);
+		itemTypeCounts[itemId] = diff;
+	} else if ((it->second += diff) == 0) {
+		itemTypeCounts.erase(it);
+	}
+
+	if (Container* parentContainer = getParentContainer()) {
+		parentContainer->updateItemTypeCount(itemId, diff);
+	}
+}
+
+bool Container::isSharedInbox(const Item* item) const
+{
+	// the inbox is added to every depot locker of its owner but only has one
+	// parent to report changes to, so lockers leave it out of their counts
+	return item->getID() == ITEM_INBOX && getDepotLocker() != nullptr;
+}
+
+void Container::addItemTypeCounts(const Item* item)
+{
+	if (isSharedInbox(item)) {
+		return;
+	}
+
+	updateItemTypeCount(item->getID(), item->getItemCount());
+	if (const Container* container = item->getContainer()) {
+		for (const auto& it : container->itemTypeCounts) {
+			updateItemTypeCount(it.first, it.second);
+		}
+	}
+}
+
+void Container::removeItemTypeCounts(const Item* item)
+{
+	if (isSharedInbox(item)) {
+		return;
+	}
+
+	updateItemTypeCount(item->getID(), -static_cast<int32_t>(item->getItemCount()));
+	if (const Container* container = item->getContainer()) {
+		for (const auto& it : container->itemTypeCounts) {
+			updateItemTypeCount(it.first, -static_cast<int32_t>(it.second));
+		}
+	}
+}
+
 uint32_t Container::getWeight() const
 {
 	return Item::getWeight() + totalWeight;
@@ -504,6 +561,7 @@ void Container::addThing(int32_t index, Thing* thing)
 	item->setParent(this);
 	itemlist.push_front(item);
 	updateItemWeight(item->getWeight());
+	addItemTypeCounts(item);
 
 	//send change to client
 	if (getParent() && (getParent() != VirtualCylinder::virtualCylinder)) {
@@ -515,6 +573,7 @@ void Container::addItemBack(Item* item)
 {
 	addItem(item);
 	updateItemWeight(item->getWeight());
+	addItemTypeCounts(item);
 
 	//send change to client
 	if (getParent() && (getParent() != VirtualCylinder::virtualCylinder)) {
@@ -535,9 +594,11 @@ void Container::updateThing(Thing* thing, uint16_t itemId, uint32_t count)
 	}
 
 	const int32_t oldWeight = item->getWeight();
+	updateItemTypeCount(item->getID(), -static_cast<int32_t>(item->getItemCount()));
 	item->setID(itemId);
 	item->setSubType(count);
 	updateItemWeight(-oldWeight + item->getWeight());
+	updateItemTypeCount(item->getID(), item->getItemCount());
 
 	//send change to client
 	if (getParent()) {
@@ -545,6 +606,15 @@ void Container::updateThing(Thing* thing, uint16_t itemId, uint32_t count)
 	}
 }
 
+void Container::resetItemSubtype(Item* item)
+{
+	const int32_t oldWeight = item->getWeight();
+	updateItemTypeCount(item->getID(), -static_cast<int32_t>(item->getItemCount()));
+	item->setDefaultSubtype();
+	updateItemWeight(-oldWeight + item->getWeight());
+	updateItemTypeCount(item->getID(), item->getItemCount());
+}
+
 void Container::replaceThing(uint32_t index, Thing* thing)
 {
 	Item* item = thing->getItem();
@@ -560,6 +630,8 @@ void Container::replaceThing(uint32_t index, Thing* thing)
 	itemlist[index] = item;
 	item->setParent(this);
 	updateItemWeight(-static_cast<int32_t>(replacedItem->getWeight()) + item->getWeight());
+	removeItemTypeCounts(replacedItem);
+	addItemTypeCounts(item);
 
 	//send change to client
 	if (getParent()) {
@@ -584,6 +656,7 @@ void Container::removeThing(Thing* thing, uint32_t count)
 	if (item->isStackable() && count != item->getItemCount()) {
 		uint8_t newCount = static_cast<uint8_t>(std::max<int32_t>(0, item->getItemCount() - count));
 		const int32_t oldWeight = item->getWeight();
+		updateItemTypeCount(item->getID(), static_cast<int32_t>(newCount) - item->getItemCount());
 		item->setItemCount(newCount);
 		updateItemWeight(-oldWeight + item->getWeight());
 
@@ -593,6 +666,7 @@ void Container::removeThing(Thing* thing, uint32_t count)
 		}
 	} else {
 		updateItemWeight(-static_cast<int32_t>(item->getWeight()));
+		removeItemTypeCounts(item);
 
 		//send change to client
 		if (getParent()) {
@@ -695,6 +769,7 @@ void Container::internalAddThing(uint32_t, Thing* thing)
 	item->setParent(this);
 	itemlist.push_front(item);
 	updateItemWeight(item->getWeight());
+	addItemTypeCounts(item);
 }
 
 void Container::startDecaying()
@@ -108,6 +108,18 @@ class Container : public Item, public Cylinder
 		bool isHoldingItem(const Item* item) const;
 
 		uint32_t getItemHoldingCount() const;
+
+		// count of an item type in this container and every container inside it
+		uint32_t getContainedItemTypeCount(uint16_t itemId) const {
+			auto it = itemTypeCounts.find(itemId);
+			if (it == itemTypeCounts.end()) {
+				return 0;
+			}
+			return it->second;
+		}
+		const std::unordered_map<uint16_t, uint32_t>& getContainedItemTypeCounts() const {
+			return itemTypeCounts;
+		}
 		uint32_t getWeight() const final;
 
 		bool isUnlocked() const {
@@ -133,6 +145,10 @@ class Container : public Item, public Cylinder
 		void updateThing(Thing* thing, uint16_t itemId, uint32_t count) final;
 		void replaceThing(uint32_t index, Thing* thing) final;
 
+		// Item::setDefaultSubtype for an item of this container, keeping its
+		// weight and type count up to date
+		void resetItemSubtype(Item* item);
+
 		void removeThing(Thing* thing, uint32_t count) final;
 
 		int32_t getThingIndex(const Thing* thing) const final;
@@ -156,13 +172,19 @@ class Container : public Item, public Cylinder
 
 		Container* getParentContainer();
 		void updateItemWeight(int32_t diff);
+		void updateItemTypeCount(uint16_t itemId, int32_t diff);
+		bool isSharedInbox(const Item* item) const;
 
 	protected:
+		void addItemTypeCounts(const Item* item);
+		void removeItemTypeCounts(const Item* item);
+
 		std::ostringstream& getContentDescription(std::ostringstream& os) const;
 
 		uint32_t maxSize;
 		uint32_t totalWeight;
 		ItemDeque itemlist;
+		std::unordered_map<uint16_t, uint32_t> itemTypeCounts;
 		uint32_t serializationCount;
 
 		bool unlocked;
@@ -45,6 +45,7 @@ Creature::Creature() :
 
 	id = 0;
 	_tile = nullptr;
+	mapFloor = nullptr;
 	direction = DIRECTION_SOUTH;
 	master = nullptr;
 	lootDrop = true;
@@ -75,7 +76,11 @@ Creature::Creature() :
 	walkUpdateTicks = 0;
 	creatureCheck = false;
 	inCheckCreaturesVector = false;
+	targetCandidate = false;
+	thinkTier = THINKTIER_VIEW;
+	thinkRoundsSkipped = 0;
 	scriptEventsBitField = 0;
+	conditionTypes = 0;
 
 	hiddenHealth = false;
 
@@ -438,6 +443,10 @@ void Creature::onRemoveTileItem(const Tile* tile, const Position& pos, const Ite
 
 void Creature::onCreatureAppear(Creature* creature, bool)
 {
+	if (thinkTier != THINKTIER_VIEW && creature->getPlayer() && creature != this) {
+		g_game.wakeCreatureThink(this);
+	}
+
 	if (creature == this) {
 		if (useCacheMap()) {
 			isMapLoaded = true;
@@ -494,6 +503,10 @@ void Creature::onAttackedCreatureChangeZone(ZoneType_t zone)
 void Creature::onCreatureMove(Creature* creature, const Tile* newTile, const Position& newPos,
                               const Tile* oldTile, const Position& oldPos, bool teleport)
 {
+	if (thinkTier != THINKTIER_VIEW && creature->getPlayer() && creature != this) {
+		g_game.wakeCreatureThink(this);
+	}
+
 	if (creature == this) {
 		lastStep = OTSYS_TIME();
 		lastStepCost = 1;
@@ -947,8 +960,7 @@ void Creature::goToFollowCreature()
 				startAutoWalk(listWalkDir);
 			}
 		} else {
-			listWalkDir.clear();
-			if (getPathTo(followCreature->getPosition(), listWalkDir, fpp)) {
+			if (getFollowPath(fpp)) {
 				hasFollowPath = true;
 				startAutoWalk(listWalkDir);
 			} else {
@@ -960,6 +972,89 @@ void Creature::goToFollowCreature()
 	onFollowCreatureComplete(followCreature);
 }
 
+bool Creature::getFollowPath(const FindPathParams& fpp)
+{
+	if (followPathPlan.ready && followPathPlan.targetId == followCreature->getID() && followPathPlan.fpp == fpp &&
+	        followPathPlan.fromPos == getPosition() && followPathPlan.targetPos == followCreature->getPosition()) {
+		listWalkDir.swap(followPathPlan.dirList);
+		bool found = followPathPlan.found;
+		clearFollowPathPlan();
+		return found;
+	}
+
+	listWalkDir.clear();
+	if (getFlowFieldPath(fpp, listWalkDir)) {
+		return true;
+	}
+	return getPathTo(followCreature->getPosition(), listWalkDir, fpp);
+}
+
+bool Creature::canUseFlowField(const FindPathParams& fpp) const
+{
+	// only plain melee chasing matches what a shared flow field describes
+	return !getPlayer() && fpp.fullPathSearch && fpp.allowDiagonal && !fpp.keepDistance &&
+	       fpp.minTargetDist <= 1 && fpp.maxTargetDist == 1;
+}
+
+bool Creature::getFlowFieldPath(const FindPathParams& fpp, std::forward_list<Direction>& dirList) const
+{
+	if (!canUseFlowField(fpp)) {
+		return false;
+	}
+
+	const FlowField* flowField = g_game.getFlowField(followCreature);
+	return flowField && flowField->getPath(*this, fpp.maxSearchDist, dirList);
+}
+
+Creature* Creature::getFlowFieldTarget() const
+{
+	if (!followCreature) {
+		return nullptr;
+	}
+
+	FindPathParams fpp;
+	getPathSearchParams(followCreature, fpp);
+	if (!canUseFlowField(fpp)) {
+		return nullptr;
+	}
+	return followCreature;
+}
+
+bool Creature::isFollowPathUpdateDue(uint32_t interval) const
+{
+	if (!followCreature) {
+		return false;
+	}
+	return isUpdatingPath || forceUpdateFollowPath || walkUpdateTicks + interval >= 2000;
+}
+
+void Creature::planFollowPath()
+{
+	// NOTE: this runs on a worker thread, everything but followPathPlan must be treated as read-only
+	clearFollowPathPlan();
+
+	if (!followCreature || (useCacheMap() && !isMapLoaded)) {
+		return;
+	}
+
+	FindPathParams fpp;
+	getPathSearchParams(followCreature, fpp);
+
+	const Monster* monster = getMonster();
+	if (monster && !monster->getMaster() && (monster->isFleeing() || fpp.maxTargetDist > 1)) {
+		// distance and flee steps are chosen by the dispatcher
+		return;
+	}
+
+	followPathPlan.fpp = fpp;
+	followPathPlan.fromPos = getPosition();
+	followPathPlan.targetPos = followCreature->getPosition();
+	followPathPlan.targetId = followCreature->getID();
+	followPathPlan.found = getFlowFieldPath(fpp, followPathPlan.dirList) ||
+	                       getPathTo(followPathPlan.targetPos, followPathPlan.dirList, fpp);
+	followPathPlan.ready = true;
+}
+
 bool Creature::setFollowCreature(Creature* creature)
 {
 	if (creature) {
@@ -1156,6 +1251,30 @@ void Creature::onGainExperience(uint64_t gainExp, Creature* target)
 	}
 }
 
+void Creature::setMaster(Creature* creature)
+{
+	master = creature;
+
+	// a summon changing sides enters or leaves the target candidates of its floor
+	if (mapFloor && targetCandidate != isMonsterTargetCandidate()) {
+		CreatureVector& candidates = mapFloor->targetCandidates;
+		if (targetCandidate) {
+			auto it = std::find(candidates.begin(), candidates.end(), this);
+			assert(it != candidates.end());
+			*it = candidates.back();
+			candidates.pop_back();
+		} else {
+			candidates.push_back(this);
+		}
+		targetCandidate = !targetCandidate;
+	}
+}
+
+bool Creature::isMonsterTargetCandidate() const
+{
+	return getPlayer() || (master && master->getPlayer());
+}
+
 void Creature::addSummon(Creature* creature)
 {
 	creature->setDropLoot(false);
@@ -1200,6 +1319,7 @@ bool Creature::addCondition(Condition* condition, bool force/* = false*/)
 
 	if (condition->startCondition(this)) {
 		conditions.push_back(condition);
+		conditionTypes |= condition->getType();
 		onAddCondition(condition->getType());
 		return true;
 	}
@@ -1240,6 +1360,7 @@ void Creature::removeCondition(ConditionType_t type, bool force/* = false*/)
 		}
 
 		it = conditions.erase(it);
+		updateConditionTypes();
 
 		condition->endCondition(this);
 		delete condition;
@@ -1267,6 +1388,7 @@ void Creature::removeCondition(ConditionType_t type, ConditionId_t id, bool forc
 		}
 
 		it = conditions.erase(it);
+		updateConditionTypes();
 
 		condition->endCondition(this);
 		delete condition;
@@ -1305,6 +1427,7 @@ void Creature::removeCondition(Condition* condition, bool force/* = false*/)
 	}
 
 	conditions.erase(it);
+	updateConditionTypes();
 
 	condition->endCondition(this);
 	onEndCondition(condition->getType());
@@ -1313,6 +1436,10 @@ void Creature::removeCondition(Condition* condition, bool force/* = false*/)
 
 Condition* Creature::getCondition(ConditionType_t type) const
 {
+	if ((conditionTypes & type) == 0) {
+		return nullptr;
+	}
+
 	for (Condition* condition : conditions) {
 		if (condition->getType() == type) {
 			return condition;
@@ -1323,6 +1450,10 @@ Condition* Creature::getCondition(ConditionType_t type) const
 
 Condition* Creature::getCondition(ConditionType_t type, ConditionId_t id, uint32_t subId/* = 0*/) const
 {
+	if ((conditionTypes & type) == 0) {
+		return nullptr;
+	}
+
 	for (Condition* condition : conditions) {
 		if (condition->getType() == type && condition->getId() == id && condition->getSubId() == subId) {
 			return condition;
@@ -1333,13 +1464,20 @@ Condition* Creature::getCondition(ConditionType_t type, ConditionId_t id, uint32
 
 void Creature::executeConditions(uint32_t interval)
 {
+	int64_t timeNow = OTSYS_TIME();
 	auto it = conditions.begin(), end = conditions.end();
 	while (it != end) {
 		Condition* condition = *it;
+		if (!condition->isPeriodic() && condition->getEndTime() >= timeNow) {
+			++it;
+			continue;
+		}
+
 		if (!condition->executeCondition(this, interval)) {
 			ConditionType_t type = condition->getType();
 
 			it = conditions.erase(it);
+			updateConditionTypes();
 
 			condition->endCondition(this);
 			delete condition;
@@ -1353,7 +1491,7 @@ void Creature::executeConditions(uint32_t interval)
 
 bool Creature::hasCondition(ConditionType_t type, uint32_t subId/* = 0*/) const
 {
-	if (isSuppress(type)) {
+	if ((conditionTypes & type) == 0 || isSuppress(type)) {
 		return false;
 	}
 
@@ -1617,9 +1755,15 @@ bool FrozenPathingConditionCall::operator()(const Position& startPos, const Posi
 
 bool Creature::isInvisible() const
 {
-	return std::find_if(conditions.begin(), conditions.end(), [] (const Condition* condition) {
-		return condition->getType() == CONDITION_INVISIBLE;
-	}) != conditions.end();
+	return (conditionTypes & CONDITION_INVISIBLE) != 0;
+}
+
+void Creature::updateConditionTypes()
+{
+	conditionTypes = 0;
+	for (const Condition* condition : conditions) {
+		conditionTypes |= condition->getType();
+	}
 }
 
 bool Creature::getPathTo(const Position& targetPos, std::forward_list<Direction>& dirList, const FindPathParams& fpp) const
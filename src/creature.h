@@ -48,6 +48,12 @@ enum slots_t : uint8_t {
 	CONST_SLOT_LAST = CONST_SLOT_AMMO,
 };
 
+enum ThinkTier_t : uint8_t {
+	THINKTIER_VIEW, // a player is in view, think every round
+	THINKTIER_NEARBY, // a player is nearby, think every EVENT_CREATURE_THINK_NEARBY_ROUNDS rounds
+	THINKTIER_SUSPENDED, // nobody around, wait for a player to come into view
+};
+
 struct FindPathParams {
 	bool fullPathSearch;
 	bool clearSight;
@@ -66,6 +72,13 @@ struct FindPathParams {
 		minTargetDist = -1;
 		maxTargetDist = -1;
 	}
+
+	bool operator==(const FindPathParams& other) const {
+		return fullPathSearch == other.fullPathSearch && clearSight == other.clearSight &&
+		       allowDiagonal == other.allowDiagonal && keepDistance == other.keepDistance &&
+		       maxSearchDist == other.maxSearchDist && minTargetDist == other.minTargetDist &&
+		       maxTargetDist == other.maxTargetDist;
+	}
 };
 
 class Map;
@@ -80,6 +93,7 @@ class Tile;
 #define EVENT_CREATURECOUNT 10
 #define EVENT_CREATURE_THINK_INTERVAL 1000
 #define EVENT_CHECK_CREATURE_INTERVAL (EVENT_CREATURE_THINK_INTERVAL / EVENT_CREATURECOUNT)
+#define EVENT_CREATURE_THINK_NEARBY_ROUNDS 4
 
 class FrozenPathingConditionCall
 {
@@ -263,6 +277,15 @@ class Creature : virtual public Thing
 		void stopEventWalk();
 		virtual void goToFollowCreature();
 
+		//follow path planning, see Game::checkCreatures
+		bool isFollowPathUpdateDue(uint32_t interval) const;
+		void planFollowPath();
+		Creature* getFlowFieldTarget() const;
+		void clearFollowPathPlan() {
+			followPathPlan.dirList.clear();
+			followPathPlan.ready = false;
+		}
+
 		//walk events
 		virtual void onWalk(Direction& dir);
 		virtual void onWalkAborted() {}
@@ -286,9 +309,7 @@ class Creature : virtual public Thing
 		virtual BlockType_t blockHit(Creature* attacker, CombatType_t combatType, int32_t& damage,
 		                             bool checkDefense = false, bool checkArmor = false, bool field = false);
 
-		void setMaster(Creature* creature) {
-			master = creature;
-		}
+		void setMaster(Creature* creature);
 		bool isSummon() const {
 			return master != nullptr;
 		}
@@ -296,6 +317,9 @@ class Creature : virtual public Thing
 			return master;
 		}
 
+		//players and their summons, the only creatures a monster can attack
+		bool isMonsterTargetCandidate() const;
+
 		void addSummon(Creature* creature);
 		void removeSummon(Creature* creature);
 		const std::list<Creature*>& getSummons() const {
@@ -472,12 +496,29 @@ class Creature : virtual public Thing
 		virtual bool useCacheMap() const {
 			return false;
 		}
+		virtual bool canSuspendThink() const {
+			return false;
+		}
 
 		struct CountBlock_t {
 			int32_t total;
 			int64_t ticks;
 		};
 
+		// A follow path computed by a worker thread before this creature
+		// thinks, it is only used if nothing it depends on has changed.
+		struct FollowPathPlan {
+			FollowPathPlan() : targetId(0), found(false), ready(false) {}
+
+			std::forward_list<Direction> dirList;
+			FindPathParams fpp;
+			Position fromPos;
+			Position targetPos;
+			uint32_t targetId;
+			bool found;
+			bool ready;
+		};
+
 		static const int32_t mapWalkWidth = Map::maxViewportX * 2 + 1;
 		static const int32_t mapWalkHeight = Map::maxViewportY * 2 + 1;
 		static const int32_t maxWalkCacheWidth = (mapWalkWidth - 1) / 2;
@@ -493,8 +534,10 @@ class Creature : virtual public Thing
 		ConditionList conditions;
 
 		std::forward_list<Direction> listWalkDir;
+		FollowPathPlan followPathPlan;
 
 		Tile* _tile;
+		Floor* mapFloor;
 		Creature* attackedCreature;
 		Creature* master;
 		Creature* followCreature;
@@ -503,6 +546,7 @@ class Creature : virtual public Thing
 		uint32_t referenceCounter;
 		uint32_t id;
 		uint32_t scriptEventsBitField;
+		uint32_t conditionTypes;
 		uint32_t eventWalk;
 		uint32_t walkUpdateTicks;
 		uint32_t lastHitCreature;
@@ -522,6 +566,8 @@ class Creature : virtual public Thing
 
 		Direction direction;
 		Skulls_t skull;
+		ThinkTier_t thinkTier;
+		uint8_t thinkRoundsSkipped;
 
 		bool localMapCache[mapWalkHeight][mapWalkWidth];
 		bool isInternalRemoved;
@@ -529,6 +575,7 @@ class Creature : virtual public Thing
 		bool isUpdatingPath;
 		bool creatureCheck;
 		bool inCheckCreaturesVector;
+		bool targetCandidate;
 		bool skillLoss;
 		bool lootDrop;
 		bool cancelNextWalk;
@@ -542,10 +589,15 @@ class Creature : virtual public Thing
 		}
 		CreatureEventList getCreatureEvents(CreatureEventType_t type);
 
+		void updateConditionTypes();
+
 		void updateMapCache();
 		void updateTileCache(const Tile* tile, int32_t dx, int32_t dy);
 		void updateTileCache(const Tile* tile, const Position& pos);
 		void onCreatureDisappear(const Creature* creature, bool isLogout);
+		bool getFollowPath(const FindPathParams& fpp);
+		bool getFlowFieldPath(const FindPathParams& fpp, std::forward_list<Direction>& dirList) const;
+		bool canUseFlowField(const FindPathParams& fpp) const;
 		virtual void doAttacking(uint32_t) {}
 		virtual bool hasExtraSwing() {
 			return false;
@@ -565,6 +617,7 @@ class Creature : virtual public Thing
 
 		friend class Game;
 		friend class Map;
+		friend class QTreeLeafNode;
 		friend class LuaScriptInterface;
 };
 
@@ -0,0 +1,113 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2015  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include "otpch.h"
+
+#include "decaywheel.h"
+
+#include "tools.h"
+
+DecayWheel::DecayWheel(uint32_t tickInterval) :
+	currentTick(OTSYS_TIME() / tickInterval), entryCount(0), tickInterval(tickInterval), sweepCursor(0) {}
+
+void DecayWheel::insert(Item* item, int64_t expiry)
+{
+	// round up, an item never decays before its time
+	int64_t tick = (expiry + tickInterval - 1) / tickInterval;
+	if (tick <= currentTick) {
+		tick = currentTick + 1;
+	}
+
+	place(Entry(item, expiry), tick);
+	++entryCount;
+}
+
+void DecayWheel::place(const Entry& entry, int64_t tick)
+{
+	int64_t delta = tick - currentTick;
+
+	uint32_t level = 0;
+	while (level < DECAYWHEEL_LEVELS - 1 && delta >= (static_cast<int64_t>(1) << (DECAYWHEEL_SLOT_BITS * (level + 1)))) {
+		++level;
+	}
+
+	const int64_t maxDelta = static_cast<int64_t>(1) << (DECAYWHEEL_SLOT_BITS * DECAYWHEEL_LEVELS);
+	if (delta >= maxDelta) {
+		// beyond the range of the wheel, the entry is placed again when
+		// the top level slot comes around
+		tick = currentTick + maxDelta - 1;
+	}
+
+	uint32_t index = (tick >> (DECAYWHEEL_SLOT_BITS * level)) & (DECAYWHEEL_SLOTS - 1);
+	slots[level][index].push_back(entry);
+}
+
+void DecayWheel::cascade(uint32_t level)
+{
+	uint32_t index = (currentTick >> (DECAYWHEEL_SLOT_BITS * level)) & (DECAYWHEEL_SLOTS - 1);
+
+	std::vector<Entry> entries;
+	entries.swap(slots[level][index]);
+	for (const Entry& entry : entries) {
+		int64_t tick = (entry.expiry + tickInterval - 1) / tickInterval;
+		place(entry, std::max(tick, currentTick));
+	}
+}
+
+void DecayWheel::advance(int64_t time, std::vector<Entry>& expired)
+{
+	const int64_t targetTick = time / tickInterval;
+	while (currentTick < targetTick) {
+		++currentTick;
+
+		for (uint32_t level = 1; level < DECAYWHEEL_LEVELS; ++level) {
+			if ((currentTick & ((static_cast<int64_t>(1) << (DECAYWHEEL_SLOT_BITS * level)) - 1)) != 0) {
+				break;
+			}
+			cascade(level);
+		}
+
+		std::vector<Entry>& slot = slots[0][currentTick & (DECAYWHEEL_SLOTS - 1)];
+		if (!slot.empty()) {
+			entryCount -= slot.size();
+			expired.insert(expired.end(), slot.begin(), slot.end());
+			slot.clear();
+		}
+	}
+}
+
+void DecayWheel::sweep(uint32_t slotCount, std::vector<Entry>& removed, const std::function<bool(const Entry&)>& predicate)
+{
+	for (uint32_t i = 0; i < slotCount; ++i) {
+		std::vector<Entry>& slot = slots[sweepCursor / DECAYWHEEL_SLOTS][sweepCursor % DECAYWHEEL_SLOTS];
+		sweepCursor = (sweepCursor + 1) % (DECAYWHEEL_LEVELS * DECAYWHEEL_SLOTS);
+
+		for (size_t j = 0; j < slot.size();) {
+			if (predicate(slot[j])) {
+				removed.push_back(slot[j]);
+				slot[j] = slot.back();
+				slot.pop_back();
+				--entryCount;
+			} else {
+				++j;
+			}
+		}
+	}
+}
@@ -0,0 +1,72 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2015  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef FS_DECAYWHEEL_H_064E752D2910494DB0B71E77CA50C4A3
+#define FS_DECAYWHEEL_H_064E752D2910494DB0B71E77CA50C4A3
+
+class Item;
+
+#define DECAYWHEEL_LEVELS 5
+#define DECAYWHEEL_SLOT_BITS 6
+#define DECAYWHEEL_SLOTS (1 << DECAYWHEEL_SLOT_BITS)
+
+/**
+  * Hierarchical timing wheel keyed by the absolute time an item expires.
+  * Each level has 64 slots and every slot of a level spans a whole turn
+  * of the level below, so an item is only moved a handful of times on its
+  * way down to the first level instead of being visited every pass.
+  */
+class DecayWheel
+{
+	public:
+		struct Entry {
+			Entry(Item* item, int64_t expiry) : item(item), expiry(expiry) {}
+
+			Item* item;
+			int64_t expiry;
+		};
+
+		explicit DecayWheel(uint32_t tickInterval);
+
+		void insert(Item* item, int64_t expiry);
+
+		// moves the entries that have expired by time into expired
+		void advance(int64_t time, std::vector<Entry>& expired);
+
+		// moves the entries of the next slotCount slots that match predicate into
+		// removed, each call continues where the previous one stopped
+		void sweep(uint32_t slotCount, std::vector<Entry>& removed, const std::function<bool(const Entry&)>& predicate);
+
+		size_t size() const {
+			return entryCount;
+		}
+
+	private:
+		void place(const Entry& entry, int64_t tick);
+		void cascade(uint32_t level);
+
+		std::vector<Entry> slots[DECAYWHEEL_LEVELS][DECAYWHEEL_SLOTS];
+		int64_t currentTick;
+		size_t entryCount;
+		uint32_t tickInterval;
+		uint32_t sweepCursor;
+};
+
+#endif
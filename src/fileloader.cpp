@@ -21,175 +21,123 @@
 
 #include "fileloader.h"
 
-FileLoader::FileLoader() : m_cached_data()
-{
-	m_file = nullptr;
-	m_root = nullptr;
-	m_buffer = new uint8_t[1024];
-	m_buffer_size = 1024;
-	m_lastError = ERROR_NONE;
-
-	//cache
-	m_cache_size = 0;
-	m_cache_index = NO_VALID_CACHE;
-	m_cache_offset = NO_VALID_CACHE;
-}
-
-FileLoader::~FileLoader()
-{
-	if (m_file) {
-		fclose(m_file);
-		m_file = nullptr;
-	}
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 
-	NodeStruct::clearNet(m_root);
-	delete[] m_buffer;
+FileLoader::FileLoader() : m_begin(nullptr), m_end(nullptr),
+	m_propsNode(nullptr), m_propsEnd(nullptr), m_closedNode(nullptr), m_closedNodeEnd(nullptr), m_lastError(ERROR_NONE) {}
 
-	for (int32_t i = 0; i < CACHE_BLOCKS; i++) {
-		delete[] m_cached_data[i].data;
-	}
-}
+FileLoader::~FileLoader() = default;
 
 bool FileLoader::openFile(const char* filename, const char* accept_identifier)
 {
-	m_file = fopen(filename, "rb");
-	if (!m_file) {
+	try {
+		boost::interprocess::file_mapping mapping(filename, boost::interprocess::read_only);
+		m_region = std::make_shared<boost::interprocess::mapped_region>(mapping, boost::interprocess::read_only);
+	} catch (const boost::interprocess::interprocess_exception&) {
+		m_region.reset();
 		m_lastError = ERROR_CAN_NOT_OPEN;
 		return false;
 	}
 
-	char identifier[4];
-	if (fread(identifier, 1, 4, m_file) < 4) {
-		fclose(m_file);
-		m_file = nullptr;
+	m_region->advise(boost::interprocess::mapped_region::advice_sequential);
+
+	m_begin = static_cast<const uint8_t*>(m_region->get_address());
+	m_end = m_begin + m_region->get_size();
+
+	if (m_end - m_begin < 4) {
 		m_lastError = ERROR_EOF;
 		return false;
 	}
 
 	// The first four bytes must either match the accept identifier or be 0x00000000 (wildcard)
-	if (memcmp(identifier, accept_identifier, 4) != 0 && memcmp(identifier, "\0\0\0\0", 4) != 0) {
-		fclose(m_file);
-		m_file = nullptr;
+	if (memcmp(m_begin, accept_identifier, 4) != 0 && memcmp(m_begin, "\0\0\0\0", 4) != 0) {
 		m_lastError = ERROR_INVALID_FILE_VERSION;
 		return false;
 	}
 
-	fseek(m_file, 0, SEEK_END);
-	int32_t file_size = ftell(m_file);
-	m_cache_size = std::min<uint32_t>(32768, std::max<uint32_t>(file_size / 20, 8192)) & ~0x1FFF;
-
-	if (!safeSeek(4)) {
+	if (m_end - m_begin < 6 || m_begin[4] != NODE_START) {
 		m_lastError = ERROR_INVALID_FORMAT;
 		return false;
 	}
-
-	delete m_root;
-	m_root = new NodeStruct();
-	m_root->start = 4;
-
-	int32_t byte;
-	if (safeSeek(4) && readByte(byte) && byte == NODE_START) {
-		return parseNode(m_root);
-	}
-
-	return false;
+	return true;
 }
 
-bool FileLoader::parseNode(NODE node)
+void FileLoader::openFile(const FileLoader& source)
 {
-	int32_t byte, pos;
-	NODE currentNode = node;
-
-	while (readByte(byte)) {
-		currentNode->type = byte;
-		bool setPropsSize = false;
-
-		while (true) {
-			if (!readByte(byte)) {
-				return false;
-			}
-
-			bool skipNode = false;
+	m_region = source.m_region;
+	m_begin = source.m_begin;
+	m_end = source.m_end;
+	m_lastError = ERROR_NONE;
+}
 
-			switch (byte) {
-				case NODE_START: {
-					//child node start
-					if (!safeTell(pos)) {
-						return false;
-					}
+const uint8_t* FileLoader::skipProps(const NODE node)
+{
+	if (node == m_propsNode) {
+		return m_propsEnd;
+	}
 
-					NODE childNode = new NodeStruct();
-					childNode->start = pos;
-					currentNode->propsSize = pos - currentNode->start - 2;
-					currentNode->child = childNode;
+	const uint8_t* p = node + 2;
+	while (p < m_end) {
+		switch (*p) {
+			case NODE_START:
+			case NODE_END:
+				m_propsNode = node;
+				m_propsEnd = p;
+				return p;
+
+			case ESCAPE_CHAR:
+				p += 2;
+				break;
 
-					setPropsSize = true;
+			default:
+				++p;
+				break;
+		}
+	}
 
-					if (!parseNode(childNode)) {
-						return false;
-					}
+	m_lastError = ERROR_INVALID_FORMAT;
+	return nullptr;
+}
 
-					break;
-				}
+const uint8_t* FileLoader::findNodeEnd(const NODE node)
+{
+	if (node == m_closedNode) {
+		return m_closedNodeEnd;
+	}
 
-				case NODE_END: {
-					//current node end
-					if (!setPropsSize) {
-						if (!safeTell(pos)) {
-							return false;
-						}
-
-						currentNode->propsSize = pos - currentNode->start - 2;
-					}
-
-					if (!readByte(byte)) {
-						return true;
-					}
-
-					switch (byte) {
-						case NODE_START: {
-							//starts next node
-							if (!safeTell(pos)) {
-								return false;
-							}
-
-							skipNode = true;
-							NODE nextNode = new NodeStruct();
-							nextNode->start = pos;
-							currentNode->next = nextNode;
-							currentNode = nextNode;
-							break;
-						}
-
-						case NODE_END:
-							return safeTell(pos) && safeSeek(pos);
-
-						default:
-							m_lastError = ERROR_INVALID_FORMAT;
-							return false;
-					}
-
-					break;
-				}
+	const uint8_t* p = skipProps(node);
+	if (!p) {
+		return nullptr;
+	}
 
-				case ESCAPE_CHAR: {
-					if (!readByte(byte)) {
-						return false;
-					}
+	uint32_t depth = 1;
+	while (p < m_end) {
+		switch (*p) {
+			case NODE_START:
+				++depth;
+				p += 2;
+				break;
 
-					break;
+			case NODE_END:
+				if (--depth == 0) {
+					return p;
 				}
+				++p;
+				break;
 
-				default:
-					break;
-			}
+			case ESCAPE_CHAR:
+				p += 2;
+				break;
 
-			if (skipNode) {
+			default:
+				++p;
 				break;
-			}
 		}
 	}
-	return false;
+
+	m_lastError = ERROR_INVALID_FORMAT;
+	return nullptr;
 }
 
 const uint8_t* FileLoader::getProps(const NODE node, size_t& size)
@@ -198,38 +146,33 @@ const uint8_t* FileLoader::getProps(const NODE node, size_t& size)
 		return nullptr;
 	}
 
-	if (node->propsSize >= m_buffer_size) {
-		delete[] m_buffer;
-
-		while (node->propsSize >= m_buffer_size) {
-			m_buffer_size *= 2;
-		}
-
-		m_buffer = new uint8_t[m_buffer_size];
+	const uint8_t* propsBegin = node + 2;
+	const uint8_t* propsEnd = skipProps(node);
+	if (!propsEnd) {
+		return nullptr;
 	}
 
-	//get buffer
-	if (!readBytes(m_buffer, node->propsSize, node->start + 2)) {
-		return nullptr;
+	const uint8_t* escape = static_cast<const uint8_t*>(memchr(propsBegin, ESCAPE_CHAR, propsEnd - propsBegin));
+	if (!escape) {
+		// nothing to unescape, hand out the mapped bytes as they are
+		size = propsEnd - propsBegin;
+		return propsBegin;
 	}
 
-	//unscape buffer
-	size_t j = 0;
-	bool escaped = false;
-	for (uint32_t i = 0; i < node->propsSize; ++i, ++j) {
-		if (m_buffer[i] == ESCAPE_CHAR) {
+	m_buffer.resize(propsEnd - propsBegin);
+	uint8_t* buffer = m_buffer.data();
+	size_t j = escape - propsBegin;
+	memcpy(buffer, propsBegin, j);
+	for (const uint8_t* p = escape; p < propsEnd; ++p, ++j) {
+		if (*p == ESCAPE_CHAR) {
 			//escape char found, skip it and write next
-			m_buffer[j] = m_buffer[++i];
-			//is neede a displacement for next bytes
-			escaped = true;
-		} else if (escaped) {
-			//perform that displacement
-			m_buffer[j] = m_buffer[i];
+			++p;
 		}
+		buffer[j] = *p;
 	}
 
 	size = j;
-	return m_buffer;
+	return buffer;
 }
 
 bool FileLoader::getProps(const NODE node, PropStream& props)
@@ -246,173 +189,82 @@ bool FileLoader::getProps(const NODE node, PropStream& props)
 
 NODE FileLoader::getChildNode(const NODE parent, uint32_t& type)
 {
-	if (parent) {
-		NODE child = parent->child;
-		if (child) {
-			type = child->type;
-		}
-
-		return child;
-	}
-
-	type = m_root->type;
-	return m_root;
-}
-
-NODE FileLoader::getNextNode(const NODE prev, uint32_t& type)
-{
-	if (!prev) {
+	if (!m_begin) {
+		m_lastError = ERROR_NOT_OPEN;
 		return NO_NODE;
 	}
 
-	NODE next = prev->next;
-	if (next) {
-		type = next->type;
+	if (!parent) {
+		NODE root = m_begin + 4;
+		m_iterations.clear();
+		m_iterations.emplace_back(nullptr, root);
+		type = root[1];
+		return root;
 	}
-	return next;
-}
 
-inline bool FileLoader::readByte(int32_t& value)
-{
-	if (m_cache_index == NO_VALID_CACHE) {
-		m_lastError = ERROR_CACHE_ERROR;
-		return false;
+	const uint8_t* p = skipProps(parent);
+	if (!p) {
+		return NO_NODE;
 	}
 
-	if (m_cache_offset >= m_cached_data[m_cache_index].size) {
-		int32_t pos = m_cache_offset + m_cached_data[m_cache_index].base;
-		int32_t tmp = getCacheBlock(pos);
-		if (tmp < 0) {
-			return false;
-		}
-
-		m_cache_index = tmp;
-		m_cache_offset = pos - m_cached_data[m_cache_index].base;
-		if (m_cache_offset >= m_cached_data[m_cache_index].size) {
-			return false;
-		}
+	if (*p == NODE_END) {
+		m_closedNode = parent;
+		m_closedNodeEnd = p;
+		return NO_NODE;
 	}
 
-	value = m_cached_data[m_cache_index].data[m_cache_offset++];
-	return true;
-}
-
-inline bool FileLoader::readBytes(uint8_t* buffer, uint32_t size, int32_t pos)
-{
-	//seek at pos
-	uint32_t remain = size, bufferPos = 0;
-	do {
-		//prepare cache
-		uint32_t i = getCacheBlock(pos);
-		if (i == NO_VALID_CACHE) {
-			return false;
-		}
-
-		m_cache_index = i;
-		m_cache_offset = pos - m_cached_data[i].base;
-
-		//get maximum read block size and calculate remaining bytes
-		uint32_t reading = std::min<int32_t>(remain, m_cached_data[i].size - m_cache_offset);
-		remain -= reading;
-
-		//read it
-		memcpy(buffer + bufferPos, m_cached_data[m_cache_index].data + m_cache_offset, reading);
-
-		//update variables
-		m_cache_offset += reading;
-		bufferPos += reading;
-		pos += reading;
-	} while (remain > 0);
-	return true;
-}
-
-inline bool FileLoader::safeSeek(uint32_t pos)
-{
-	uint32_t i = getCacheBlock(pos);
-	if (i == NO_VALID_CACHE) {
-		return false;
+	if (p + 1 >= m_end) {
+		m_lastError = ERROR_INVALID_FORMAT;
+		return NO_NODE;
 	}
 
-	m_cache_index = i;
-	m_cache_offset = pos - m_cached_data[i].base;
-	return true;
+	m_iterations.emplace_back(parent, p);
+	type = p[1];
+	return p;
 }
 
-inline bool FileLoader::safeTell(int32_t& pos)
+NODE FileLoader::getNextNode(const NODE prev, uint32_t& type)
 {
-	if (m_cache_index == NO_VALID_CACHE) {
-		m_lastError = ERROR_CACHE_ERROR;
-		return false;
+	if (!prev) {
+		return NO_NODE;
 	}
 
-	pos = m_cached_data[m_cache_index].base + m_cache_offset - 1;
-	return true;
-}
-
-inline uint32_t FileLoader::getCacheBlock(uint32_t pos)
-{
-	bool found = false;
-	uint32_t i, base_pos = pos & ~(m_cache_size - 1);
-
-	for (i = 0; i < CACHE_BLOCKS; i++) {
-		if (m_cached_data[i].loaded) {
-			if (m_cached_data[i].base == base_pos) {
-				found = true;
-				break;
-			}
-		}
+	const uint8_t* p = findNodeEnd(prev);
+	if (!p) {
+		return NO_NODE;
 	}
 
-	if (!found) {
-		i = loadCacheBlock(pos);
+	// find the iteration prev belongs to, anything started below it was left unfinished
+	auto it = m_iterations.rbegin();
+	while (it != m_iterations.rend() && it->second != prev) {
+		++it;
 	}
+	const bool found = it != m_iterations.rend();
+	m_iterations.erase(it.base(), m_iterations.end());
 
-	return i;
-}
-
-int32_t FileLoader::loadCacheBlock(uint32_t pos)
-{
-	int32_t i, loading_cache = -1, base_pos = pos & ~(m_cache_size - 1);
-
-	for (i = 0; i < CACHE_BLOCKS; i++) {
-		if (!m_cached_data[i].loaded) {
-			loading_cache = i;
-			break;
-		}
+	// the byte after prev either starts the next sibling or closes the parent
+	if (++p >= m_end) {
+		return NO_NODE;
 	}
 
-	if (loading_cache == -1) {
-		for (i = 0; i < CACHE_BLOCKS; i++) {
-			if (std::abs(static_cast<long>(m_cached_data[i].base) - base_pos) > static_cast<long>(2 * m_cache_size)) {
-				loading_cache = i;
-				break;
-			}
+	if (*p == NODE_START) {
+		if (p + 1 >= m_end) {
+			m_lastError = ERROR_INVALID_FORMAT;
+			return NO_NODE;
 		}
 
-		if (loading_cache == -1) {
-			loading_cache = 0;
+		if (found) {
+			m_iterations.back().second = p;
 		}
-	}
-
-	if (m_cached_data[loading_cache].data == nullptr) {
-		m_cached_data[loading_cache].data = new uint8_t[m_cache_size];
-	}
 
-	m_cached_data[loading_cache].base = base_pos;
-
-	if (fseek(m_file, m_cached_data[loading_cache].base, SEEK_SET) != 0) {
-		m_lastError = ERROR_SEEK_ERROR;
-		return -1;
+		type = p[1];
+		return p;
 	}
 
-	uint32_t size = fread(m_cached_data[loading_cache].data, 1, m_cache_size, m_file);
-	m_cached_data[loading_cache].size = size;
-
-	if (size < (pos - m_cached_data[loading_cache].base)) {
-		m_lastError = ERROR_SEEK_ERROR;
-		return -1;
+	if (found) {
+		m_closedNode = m_iterations.back().first;
+		m_closedNodeEnd = p;
+		m_iterations.pop_back();
 	}
-
-	m_cached_data[loading_cache].loaded = 1;
-	return loading_cache;
+	return NO_NODE;
 }
@@ -20,53 +20,10 @@
 #ifndef FS_FILELOADER_H_9B663D19E58D42E6BFACFE5B09D7A05E
 #define FS_FILELOADER_H_9B663D19E58D42E6BFACFE5B09D7A05E
 
-struct NodeStruct;
+#include <boost/interprocess/interprocess_fwd.hpp>
 
-typedef NodeStruct* NODE;
-
-struct NodeStruct {
-	NodeStruct() : start(0), propsSize(0), type(0), next(nullptr), child(nullptr) {}
-
-	uint32_t start;
-	uint32_t propsSize;
-	uint32_t type;
-	NodeStruct* next;
-	NodeStruct* child;
-
-	static void clearNet(NodeStruct* root) {
-		if (root) {
-			clearChild(root);
-		}
-	}
-
-	private:
-		static void clearNext(NodeStruct* node) {
-			NodeStruct* deleteNode = node;
-			NodeStruct* nextNode;
-
-			while (deleteNode) {
-				if (deleteNode->child) {
-					clearChild(deleteNode->child);
-				}
-
-				nextNode = deleteNode->next;
-				delete deleteNode;
-				deleteNode = nextNode;
-			}
-		}
-
-		static void clearChild(NodeStruct* node) {
-			if (node->child) {
-				clearChild(node->child);
-			}
-
-			if (node->next) {
-				clearNext(node->next);
-			}
-
-			delete node;
-		}
-};
+// a node is referenced by a pointer to its NODE_START byte inside the mapped file
+typedef const uint8_t* NODE;
 
 #define NO_NODE 0
 
@@ -87,6 +44,12 @@ enum FILELOADER_ERRORS {
 
 class PropStream;
 
+/**
+  * Reads node files (OTBM, OTB) straight out of a read-only memory mapping.
+  * Nodes are walked in place while the caller iterates them, no node tree
+  * is built, and node properties are handed out as views into the mapping
+  * unless they contain escaped bytes.
+  */
 class FileLoader
 {
 	public:
@@ -98,6 +61,8 @@ class FileLoader
 		FileLoader& operator=(const FileLoader&) = delete;
 
 		bool openFile(const char* filename, const char* identifier);
+		// walks the file already opened by source, each thread reading a file needs its own loader
+		void openFile(const FileLoader& source);
 		const uint8_t* getProps(const NODE, size_t& size);
 		bool getProps(const NODE, PropStream& props);
 		NODE getChildNode(const NODE parent, uint32_t& type);
@@ -114,38 +79,28 @@ class FileLoader
 			NODE_END = 0xFF,
 		};
 
-		bool parseNode(NODE node);
+		// returns the first unescaped NODE_START/NODE_END after the properties of node
+		const uint8_t* skipProps(const NODE node);
+		// returns the NODE_END byte closing node
+		const uint8_t* findNodeEnd(const NODE node);
 
-		inline bool readByte(int32_t& value);
-		inline bool readBytes(uint8_t* buffer, uint32_t size, int32_t pos);
-		inline bool safeSeek(uint32_t pos);
-		inline bool safeTell(int32_t& pos);
+		std::shared_ptr<boost::interprocess::mapped_region> m_region;
+		const uint8_t* m_begin;
+		const uint8_t* m_end;
 
-	protected:
-		struct _cache {
-			uint8_t* data;
-			uint32_t loaded;
-			uint32_t base;
-			uint32_t size;
-		};
+		// nodes are visited depth first, so remembering where the last
+		// scans stopped lets every byte of the file be scanned only once
+		const uint8_t* m_propsNode;
+		const uint8_t* m_propsEnd;
+		const uint8_t* m_closedNode;
+		const uint8_t* m_closedNodeEnd;
 
-#define CACHE_BLOCKS 3
-		_cache m_cached_data[CACHE_BLOCKS];
+		// parent and current child of every sibling iteration in progress
+		std::vector<std::pair<NODE, NODE>> m_iterations;
 
-		uint8_t* m_buffer;
-		NODE m_root;
-		FILE* m_file;
+		std::vector<uint8_t> m_buffer;
 
 		FILELOADER_ERRORS m_lastError;
-		uint32_t m_buffer_size;
-
-		uint32_t m_cache_size;
-#define NO_VALID_CACHE 0xFFFFFFFF
-		uint32_t m_cache_index;
-		uint32_t m_cache_offset;
-
-		inline uint32_t getCacheBlock(uint32_t pos);
-		int32_t loadCacheBlock(uint32_t pos);
 };
 
 class PropStream
@@ -0,0 +1,187 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2015  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "flowfield.h"
+
+#include "game.h"
+
+extern Game g_game;
+
+static const int_fast32_t flowNeighbors[8][2] = {
+	{-1, 0}, {0, 1}, {1, 0}, {0, -1}, {-1, -1}, {1, -1}, {1, 1}, {-1, 1}
+};
+
+static const Direction flowDirections[8] = {
+	DIRECTION_WEST, DIRECTION_SOUTH, DIRECTION_EAST, DIRECTION_NORTH,
+	DIRECTION_NORTHWEST, DIRECTION_NORTHEAST, DIRECTION_SOUTHEAST, DIRECTION_SOUTHWEST
+};
+
+static inline int_fast32_t getStepCost(const int_fast32_t* offset)
+{
+	return offset[0] != 0 && offset[1] != 0 ? MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST;
+}
+
+static bool isFlowWalkable(const Tile* tile)
+{
+	if (!tile || !tile->ground) {
+		return false;
+	}
+
+	return !tile->hasFlag(TILESTATE_BLOCKSOLID) && !tile->hasFlag(TILESTATE_BLOCKPATH) &&
+	       !tile->hasFlag(TILESTATE_FLOORCHANGE) && !tile->hasFlag(TILESTATE_TELEPORT) &&
+	       !tile->hasFlag(TILESTATE_PROTECTIONZONE);
+}
+
+void FlowField::build(const Position& targetPos, int64_t time)
+{
+	this->targetPos = targetPos;
+	buildTime = time;
+
+	const int32_t baseX = targetPos.x - FLOWFIELD_RADIUS;
+	const int32_t baseY = targetPos.y - FLOWFIELD_RADIUS;
+
+	std::vector<bool> walkable(FLOWFIELD_SIZE * FLOWFIELD_SIZE);
+	for (int32_t y = 0; y < FLOWFIELD_SIZE; ++y) {
+		for (int32_t x = 0; x < FLOWFIELD_SIZE; ++x) {
+			if (baseX + x >= 0 && baseY + y >= 0) {
+				walkable[y * FLOWFIELD_SIZE + x] = isFlowWalkable(g_game.map.getTile(baseX + x, baseY + y, targetPos.z));
+			}
+		}
+	}
+
+	distances.assign(FLOWFIELD_SIZE * FLOWFIELD_SIZE, UNREACHABLE);
+
+	typedef std::pair<uint32_t, uint16_t> OpenCell;
+	std::vector<OpenCell> open;
+
+	// every walkable tile next to the target is a goal
+	for (const auto& offset : flowNeighbors) {
+		uint16_t index = (FLOWFIELD_RADIUS + offset[1]) * FLOWFIELD_SIZE + FLOWFIELD_RADIUS + offset[0];
+		if (walkable[index]) {
+			distances[index] = 0;
+			open.emplace_back(0, index);
+		}
+	}
+	std::make_heap(open.begin(), open.end(), std::greater<OpenCell>());
+
+	while (!open.empty()) {
+		std::pop_heap(open.begin(), open.end(), std::greater<OpenCell>());
+		OpenCell cell = open.back();
+		open.pop_back();
+
+		if (cell.first != distances[cell.second]) {
+			continue;
+		}
+
+		const int32_t x = cell.second % FLOWFIELD_SIZE;
+		const int32_t y = cell.second / FLOWFIELD_SIZE;
+		for (const auto& offset : flowNeighbors) {
+			const int32_t nx = x + offset[0];
+			const int32_t ny = y + offset[1];
+			if (nx < 0 || ny < 0 || nx >= FLOWFIELD_SIZE || ny >= FLOWFIELD_SIZE) {
+				continue;
+			}
+
+			uint16_t index = ny * FLOWFIELD_SIZE + nx;
+			if (!walkable[index]) {
+				continue;
+			}
+
+			uint32_t distance = cell.first + getStepCost(offset);
+			if (distance < distances[index]) {
+				distances[index] = distance;
+				open.emplace_back(distance, index);
+				std::push_heap(open.begin(), open.end(), std::greater<OpenCell>());
+			}
+		}
+	}
+}
+
+uint16_t FlowField::getDistance(const Position& pos) const
+{
+	if (pos.z != targetPos.z) {
+		return UNREACHABLE;
+	}
+
+	const int32_t x = pos.x - targetPos.x + FLOWFIELD_RADIUS;
+	const int32_t y = pos.y - targetPos.y + FLOWFIELD_RADIUS;
+	if (x < 0 || y < 0 || x >= FLOWFIELD_SIZE || y >= FLOWFIELD_SIZE) {
+		return UNREACHABLE;
+	}
+	return distances[y * FLOWFIELD_SIZE + x];
+}
+
+bool FlowField::getPath(const Creature& creature, int32_t maxSearchDist, std::forward_list<Direction>& dirList) const
+{
+	const Position& startPos = creature.getPosition();
+	Position pos = startPos;
+	uint16_t distance = getDistance(pos);
+	if (distance == UNREACHABLE) {
+		return false;
+	}
+
+	auto last = dirList.before_begin();
+	while (distance != 0) {
+		int32_t bestIndex = -1;
+		int_fast32_t bestCost = std::numeric_limits<int_fast32_t>::max();
+		for (int32_t i = 0; i < 8; ++i) {
+			Position neighborPos(pos.x + flowNeighbors[i][0], pos.y + flowNeighbors[i][1], pos.z);
+
+			uint16_t neighborDistance = getDistance(neighborPos);
+			if (neighborDistance >= distance) {
+				continue;
+			}
+
+			// A* would not look there
+			if (maxSearchDist != 0 && (Position::getDistanceX(startPos, neighborPos) > maxSearchDist || Position::getDistanceY(startPos, neighborPos) > maxSearchDist)) {
+				continue;
+			}
+
+			const Tile* tile = g_game.map.canWalkTo(creature, neighborPos);
+			if (!tile) {
+				continue;
+			}
+
+			// the field does not know what such a tile costs this creature,
+			// A* may well route around it
+			if (AStarNodes::getTileWalkCost(creature, tile) != 0) {
+				continue;
+			}
+
+			int_fast32_t cost = neighborDistance + getStepCost(flowNeighbors[i]);
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestIndex = i;
+			}
+		}
+
+		if (bestIndex == -1) {
+			dirList.clear();
+			return false;
+		}
+
+		last = dirList.insert_after(last, flowDirections[bestIndex]);
+		pos.x += flowNeighbors[bestIndex][0];
+		pos.y += flowNeighbors[bestIndex][1];
+		distance = getDistance(pos);
+	}
+	return true;
+}
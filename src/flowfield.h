@@ -0,0 +1,66 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2015  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_FLOWFIELD_H_B974E68E8D5B4C81A7961AA9D55B351F
+#define FS_FLOWFIELD_H_B974E68E8D5B4C81A7961AA9D55B351F
+
+#include "position.h"
+
+class Creature;
+
+// the search distance of a chase plus the step next to the target
+#define FLOWFIELD_RADIUS 13
+#define FLOWFIELD_SIZE (FLOWFIELD_RADIUS * 2 + 1)
+
+/**
+  * Walking distance to the tiles next to one target, shared by every
+  * creature chasing that target instead of each of them running its own
+  * A* search. The field only knows which tiles block every walker; a
+  * creature descending it falls back to A* as soon as it would leave its
+  * search distance, get stuck or step on a tile that costs it extra
+  * (creatures in the way, fields it is not immune to).
+  */
+class FlowField
+{
+	public:
+		FlowField() : buildTime(0) {}
+
+		void build(const Position& targetPos, int64_t time);
+
+		// path to a tile next to the target, only valid for melee chasing
+		bool getPath(const Creature& creature, int32_t maxSearchDist, std::forward_list<Direction>& dirList) const;
+
+		const Position& getTargetPosition() const {
+			return targetPos;
+		}
+		int64_t getBuildTime() const {
+			return buildTime;
+		}
+
+	private:
+		static const uint16_t UNREACHABLE = 0xFFFF;
+
+		uint16_t getDistance(const Position& pos) const;
+
+		std::vector<uint16_t> distances;
+		Position targetPos;
+		int64_t buildTime;
+};
+
+#endif
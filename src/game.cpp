@@ -51,6 +51,7 @@
 #include "connection.h"
 #include "events.h"
 #include "databasetasks.h"
+#include "workerpool.h"
 
 extern ConfigManager g_config;
 extern Actions* g_actions;
@@ -62,6 +63,7 @@ extern GlobalEvents* g_globalEvents;
 extern Events* g_events;
 
 Game::Game() :
+	decayWheel(EVENT_DECAYINTERVAL),
 	wildcardTree(false),
 	offlineTrainingWindow(std::numeric_limits<uint32_t>::max(), "Choose a Skill", "Please choose a skill:")
 {
@@ -75,8 +77,6 @@ Game::Game() :
 	useLastStageLevel = false;
 	stagesEnabled = false;
 
-	lastBucket = 0;
-
 	//(1440 minutes/day)/(3600 seconds/day)*10 seconds event interval
 	int32_t dayCycle = 3600;
 	lightHourDelta = 1440 * 10 / dayCycle;
@@ -1641,7 +1641,13 @@ Item* Game::transformItem(Item* item, uint16_t newId, int32_t newCount /*= -1*/)
 
 			if (curType.id != newType.id) {
 				if (newType.group != curType.group) {
-					item->setDefaultSubtype();
+					// the stack size goes through the container, updateThing
+					// takes the count it removes from the item as it is then
+					if (Container* container = cylinder->getContainer()) {
+						container->resetItemSubtype(item);
+					} else {
+						item->setDefaultSubtype();
+					}
 				}
 
 				itemId = newId;
@@ -2304,6 +2310,10 @@ void Game::playerWriteItem(uint32_t playerId, uint32_t windowTextId, const std::
 		writeItem->resetDate();
 	}
 
+	if (Tile* tile = writeItem->getTile()) {
+		tile->setHouseItemsChanged();
+	}
+
 	uint16_t newId = Item::items[writeItem->getID()].writeOnceItemId;
 	if (newId != 0) {
 		transformItem(writeItem, newId);
@@ -3538,19 +3548,74 @@ void Game::removeCreatureCheck(Creature* creature)
 	}
 }
 
+void Game::wakeCreatureThink(Creature* creature)
+{
+	if (creature->thinkTier == THINKTIER_SUSPENDED) {
+		creature->thinkTier = THINKTIER_VIEW;
+		addCreatureCheck(creature);
+	} else {
+		creature->thinkTier = THINKTIER_VIEW;
+	}
+}
+
+void Game::updateCreatureThinkTier(Creature* creature)
+{
+	if (creature->getPlayer()) {
+		return;
+	}
+
+	const Position& pos = creature->getPosition();
+
+	SpectatorVec list;
+	map.getSpectators(list, pos, true, true, Map::maxViewportX * 2, Map::maxViewportX * 2, Map::maxViewportY * 2, Map::maxViewportY * 2);
+
+	ThinkTier_t tier = THINKTIER_SUSPENDED;
+	for (Creature* spectator : list) {
+		if (Position::areInRange<Map::maxViewportX, Map::maxViewportY>(spectator->getPosition(), pos)) {
+			tier = THINKTIER_VIEW;
+			break;
+		}
+		tier = THINKTIER_NEARBY;
+	}
+
+	if (tier == THINKTIER_SUSPENDED && (!creature->canSuspendThink() || creature->hasEventRegistered(CREATURE_EVENT_THINK))) {
+		tier = THINKTIER_NEARBY;
+	}
+
+	creature->thinkTier = tier;
+	if (tier == THINKTIER_SUSPENDED) {
+		// woken up again by Creature::onCreatureAppear/onCreatureMove
+		removeCreatureCheck(creature);
+	}
+}
+
 void Game::checkCreatures(size_t index)
 {
 	g_scheduler.addEvent(createSchedulerTask(EVENT_CHECK_CREATURE_INTERVAL, std::bind(&Game::checkCreatures, this, (index + 1) % EVENT_CREATURECOUNT)));
 
 	auto& checkCreatureList = checkCreatureLists[index];
+	planCreatureThink(checkCreatureList);
+
 	auto it = checkCreatureList.begin(), end = checkCreatureList.end();
 	while (it != end) {
 		Creature* creature = *it;
 		if (creature->creatureCheck) {
 			if (creature->getHealth() > 0) {
-				creature->onThink(EVENT_CREATURE_THINK_INTERVAL);
-				creature->onAttacking(EVENT_CREATURE_THINK_INTERVAL);
-				creature->executeConditions(EVENT_CREATURE_THINK_INTERVAL);
+				// creatures away from players think less often, with the
+				// skipped rounds added to the interval they are given;
+				// conditions apply at most one step per call, so they run
+				// every round whatever the tier
+				uint32_t interval = EVENT_CREATURE_THINK_INTERVAL * (creature->thinkRoundsSkipped + 1);
+				if (creature->thinkTier == THINKTIER_VIEW || ++creature->thinkRoundsSkipped >= EVENT_CREATURE_THINK_NEARBY_ROUNDS) {
+					creature->thinkRoundsSkipped = 0;
+					creature->onThink(interval);
+					creature->onAttacking(interval);
+					creature->executeConditions(EVENT_CREATURE_THINK_INTERVAL);
+					creature->clearFollowPathPlan();
+					updateCreatureThinkTier(creature);
+				} else {
+					creature->executeConditions(EVENT_CREATURE_THINK_INTERVAL);
+				}
 			} else {
 				creature->onDeath();
 			}
@@ -3565,6 +3630,66 @@ void Game::checkCreatures(size_t index)
 	cleanup();
 }
 
+void Game::planCreatureThink(const std::list<Creature*>& checkCreatureList)
+{
+	// The world does not change while the workers run, so every plan only
+	// depends on the state at the start of this tick; the plans are then
+	// used in list order by onThink, or recomputed if they went stale.
+	std::vector<Creature*> planList;
+	for (Creature* creature : checkCreatureList) {
+		if (creature->creatureCheck && creature->getHealth() > 0 && !creature->getPlayer() &&
+		        (creature->thinkTier == THINKTIER_VIEW || creature->thinkRoundsSkipped + 1 >= EVENT_CREATURE_THINK_NEARBY_ROUNDS) &&
+		        creature->isFollowPathUpdateDue(EVENT_CREATURE_THINK_INTERVAL * (creature->thinkRoundsSkipped + 1))) {
+			planList.push_back(creature);
+		}
+	}
+
+	updateFlowFields(planList);
+
+	if (g_workerPool.getThreadCount() == 0) {
+		return;
+	}
+
+	g_workerPool.parallelFor(planList.size(), [&planList](size_t i) {
+		planList[i]->planFollowPath();
+	});
+}
+
+void Game::updateFlowFields(const std::vector<Creature*>& planList)
+{
+	// a field is rebuilt when its target moved, or after a think interval so
+	// that doors, walls and other map changes are picked up
+	const int64_t now = OTSYS_TIME();
+	for (auto it = flowFields.begin(); it != flowFields.end();) {
+		if (it->second.getBuildTime() + EVENT_CREATURE_THINK_INTERVAL <= now) {
+			it = flowFields.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	for (Creature* creature : planList) {
+		Creature* target = creature->getFlowFieldTarget();
+		if (!target) {
+			continue;
+		}
+
+		FlowField& flowField = flowFields[target->getID()];
+		if (flowField.getBuildTime() == 0 || flowField.getTargetPosition() != target->getPosition()) {
+			flowField.build(target->getPosition(), now);
+		}
+	}
+}
+
+const FlowField* Game::getFlowField(const Creature* target) const
+{
+	auto it = flowFields.find(target->getID());
+	if (it == flowFields.end() || it->second.getTargetPosition() != target->getPosition()) {
+		return nullptr;
+	}
+	return &it->second;
+}
+
 void Game::changeSpeed(Creature* creature, int32_t varSpeedDelta)
 {
 	int32_t varSpeed = creature->getSpeed() - creature->getBaseSpeed();
@@ -4005,7 +4130,7 @@ bool Game::combatChangeHealth(Creature* attacker, Creature* target, CombatDamage
 		if (list.empty()) {
 			map.getSpectators(list, targetPos, true, true);
 		}
-		addCreatureHealth(list, target);
+		addCreatureHealth(target);
 
 		message.primary.value = damage.primary.value;
 		message.secondary.value = damage.secondary.value;
@@ -4180,18 +4305,7 @@ bool Game::combatChangeMana(Creature* attacker, Creature* target, int32_t manaCh
 
 void Game::addCreatureHealth(const Creature* target)
 {
-	SpectatorVec list;
-	map.getSpectators(list, target->getPosition(), true, true);
-	addCreatureHealth(list, target);
-}
-
-void Game::addCreatureHealth(const SpectatorVec& list, const Creature* target)
-{
-	for (Creature* spectator : list) {
-		if (Player* tmpPlayer = spectator->getPlayer()) {
-			tmpPlayer->sendCreatureHealth(target);
-		}
-	}
+	queueCreatureUpdate(target, CREATUREUPDATE_HEALTH);
 }
 
 void Game::addMagicEffect(const Position& pos, uint8_t effect)
@@ -4210,6 +4324,15 @@ void Game::addMagicEffect(const SpectatorVec& list, const Position& pos, uint8_t
 	}
 }
 
+void Game::addMagicEffect(const SpectatorVec& list, const std::vector<Position>& positions, uint8_t effect)
+{
+	for (Creature* spectator : list) {
+		if (Player* tmpPlayer = spectator->getPlayer()) {
+			tmpPlayer->sendMagicEffect(positions, effect);
+		}
+	}
+}
+
 void Game::addDistanceEffect(const Position& fromPos, const Position& toPos, uint8_t effect)
 {
 	SpectatorVec list;
@@ -4229,7 +4352,14 @@ void Game::addDistanceEffect(const SpectatorVec& list, const Position& fromPos,
 
 void Game::startDecay(Item* item)
 {
-	if (!item || !item->canDecay()) {
+	if (!item) {
+		return;
+	}
+
+	if (!item->canDecay()) {
+		// e.g. a ring taken off turns into a type without decay time and
+		// keeps the time it has left until it is put on again
+		stopDecay(item);
 		return;
 	}
 
@@ -4241,12 +4371,32 @@ void Game::startDecay(Item* item)
 	if (item->getDuration() > 0) {
 		item->incrementReferenceCounter();
 		item->setDecaying(DECAYING_TRUE);
-		toDecayItems.push_front(item);
+		decayWheel.insert(item, item->getDecayExpiry());
+
+		// the time left is saved but counts down without notifications
+		if (Tile* tile = item->getTile()) {
+			tile->setHouseItemsChanged();
+		}
 	} else {
 		internalDecayItem(item);
 	}
 }
 
+void Game::stopDecay(Item* item)
+{
+	if (item->getDecaying() != DECAYING_TRUE) {
+		return;
+	}
+
+	// the wheel entry is left behind, it no longer matches the item and is
+	// dropped by the sweep in checkDecay
+	item->setDecaying(DECAYING_FALSE);
+
+	if (Tile* tile = item->getTile()) {
+		tile->setHouseItemsChanged();
+	}
+}
+
 void Game::internalDecayItem(Item* item)
 {
 	const ItemType& it = Item::items[item->getID()];
@@ -4261,50 +4411,55 @@ void Game::internalDecayItem(Item* item)
 	}
 }
 
+void Game::checkMapClean()
+{
+	if (map.cleanStep()) {
+		g_scheduler.addEvent(createSchedulerTask(EVENT_MAP_CLEAN_INTERVAL, std::bind(&Game::checkMapClean, this)));
+	}
+}
+
 void Game::checkDecay()
 {
 	g_scheduler.addEvent(createSchedulerTask(EVENT_DECAYINTERVAL, std::bind(&Game::checkDecay, this)));
 
-	size_t bucket = (lastBucket + 1) % EVENT_DECAY_BUCKETS;
+	decayWheel.advance(OTSYS_TIME(), expiredDecayItems);
+
+	for (const DecayWheel::Entry& entry : expiredDecayItems) {
+		Item* item = entry.item;
+		if (item->getDecaying() != DECAYING_TRUE || item->getDecayExpiry() != entry.expiry) {
+			// stopped or restarted with another duration after this entry was scheduled
+			ReleaseItem(item);
+			continue;
+		}
 
-	auto it = decayItems[bucket].begin(), end = decayItems[bucket].end();
-	while (it != end) {
-		Item* item = *it;
 		if (!item->canDecay()) {
 			item->setDecaying(DECAYING_FALSE);
 			ReleaseItem(item);
-			it = decayItems[bucket].erase(it);
 			continue;
 		}
 
-		int32_t decreaseTime = EVENT_DECAYINTERVAL * EVENT_DECAY_BUCKETS;
-		int32_t duration = item->getDuration();
-		if (duration - decreaseTime < 0) {
-			decreaseTime = duration;
-		}
+		internalDecayItem(item);
+		ReleaseItem(item);
+	}
+	expiredDecayItems.clear();
 
-		duration -= decreaseTime;
-		item->decreaseDuration(decreaseTime);
+	// entries of stopped or restarted decays and of items that left the game
+	// are looked for a part of the wheel at a time, so their references are
+	// not held until the entry would have expired
+	decayWheel.sweep(EVENT_DECAY_SWEEP_SLOTS, expiredDecayItems, [](const DecayWheel::Entry& entry) {
+		const Item* item = entry.item;
+		return item->getDecaying() != DECAYING_TRUE || item->getDecayExpiry() != entry.expiry || !item->canDecay();
+	});
 
-		if (duration <= 0) {
-			it = decayItems[bucket].erase(it);
-			internalDecayItem(item);
-			ReleaseItem(item);
-		} else if (duration < EVENT_DECAYINTERVAL * EVENT_DECAY_BUCKETS) {
-			it = decayItems[bucket].erase(it);
-			size_t newBucket = (bucket + ((duration + EVENT_DECAYINTERVAL / 2) / 1000)) % EVENT_DECAY_BUCKETS;
-			if (newBucket == bucket) {
-				internalDecayItem(item);
-				ReleaseItem(item);
-			} else {
-				decayItems[newBucket].push_back(item);
-			}
-		} else {
-			++it;
+	for (const DecayWheel::Entry& entry : expiredDecayItems) {
+		Item* item = entry.item;
+		if (item->getDecaying() == DECAYING_TRUE && item->getDecayExpiry() == entry.expiry) {
+			item->setDecaying(DECAYING_FALSE);
 		}
+		ReleaseItem(item);
 	}
+	expiredDecayItems.clear();
 
-	lastBucket = bucket;
 	cleanup();
 }
 
@@ -4389,6 +4544,7 @@ void Game::shutdown()
 
 	g_scheduler.shutdown();
 	g_databaseTasks.shutdown();
+	g_workerPool.shutdown();
 	g_dispatcher.shutdown();
 	map.spawns.clear();
 	raids.clear();
@@ -4416,16 +4572,6 @@ void Game::cleanup()
 		item->decrementReferenceCounter();
 	}
 	ToReleaseItems.clear();
-
-	for (Item* item : toDecayItems) {
-		const uint32_t dur = item->getDuration();
-		if (dur >= EVENT_DECAYINTERVAL * EVENT_DECAY_BUCKETS) {
-			decayItems[lastBucket].push_back(item);
-		} else {
-			decayItems[(lastBucket + 1 + dur / 1000) % EVENT_DECAY_BUCKETS].push_back(item);
-		}
-	}
-	toDecayItems.clear();
 }
 
 void Game::ReleaseCreature(Creature* creature)
@@ -4463,19 +4609,51 @@ void Game::updateCreatureSkull(const Creature* creature)
 		return;
 	}
 
-	SpectatorVec list;
-	map.getSpectators(list, creature->getPosition(), true, true);
-	for (Creature* spectator : list) {
-		spectator->getPlayer()->sendCreatureSkull(creature);
-	}
+	queueCreatureUpdate(creature, CREATUREUPDATE_SKULL);
 }
 
 void Game::updatePlayerShield(Player* player)
 {
-	SpectatorVec list;
-	map.getSpectators(list, player->getPosition(), true, true);
-	for (Creature* spectator : list) {
-		spectator->getPlayer()->sendCreatureShield(player);
+	queueCreatureUpdate(player, CREATUREUPDATE_SHIELD);
+}
+
+void Game::queueCreatureUpdate(const Creature* creature, CreatureUpdate_t update)
+{
+	// health, skull and shield only show the latest state, so a creature hit
+	// several times during one round of dispatcher tasks is sent only once
+	if (creatureUpdates.empty()) {
+		g_dispatcher.addTask(createTask(std::bind(&Game::sendCreatureUpdates, this)));
+	}
+	creatureUpdates[creature->getID()] |= update;
+}
+
+void Game::sendCreatureUpdates()
+{
+	std::unordered_map<uint32_t, uint8_t> updates;
+	updates.swap(creatureUpdates);
+
+	for (const auto& it : updates) {
+		Creature* creature = getCreatureByID(it.first);
+		if (!creature || creature->isRemoved()) {
+			continue;
+		}
+
+		SpectatorVec list;
+		map.getSpectators(list, creature->getPosition(), true, true);
+		for (Creature* spectator : list) {
+			Player* tmpPlayer = spectator->getPlayer();
+			if (it.second & CREATUREUPDATE_HEALTH) {
+				tmpPlayer->sendCreatureHealth(creature);
+			}
+
+			if (it.second & CREATUREUPDATE_SKULL) {
+				tmpPlayer->sendCreatureSkull(creature);
+			}
+
+			if (it.second & CREATUREUPDATE_SHIELD) {
+				tmpPlayer->sendCreatureShield(creature);
+			}
+		}
 	}
 }
 
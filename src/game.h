@@ -33,6 +33,8 @@
 #include "npc.h"
 #include "wildcardtree.h"
 #include "quests.h"
+#include "flowfield.h"
+#include "decaywheel.h"
 
 class ServiceManager;
 class Creature;
@@ -64,6 +66,12 @@ enum GameState_t {
 	GAME_STATE_MAINTAIN,
 };
 
+enum CreatureUpdate_t : uint8_t {
+	CREATUREUPDATE_HEALTH = 1 << 0,
+	CREATUREUPDATE_SKULL = 1 << 1,
+	CREATUREUPDATE_SHIELD = 1 << 2,
+};
+
 enum LightState_t {
 	LIGHT_STATE_DAY,
 	LIGHT_STATE_NIGHT,
@@ -73,7 +81,7 @@ enum LightState_t {
 
 #define EVENT_LIGHTINTERVAL 10000
 #define EVENT_DECAYINTERVAL 250
-#define EVENT_DECAY_BUCKETS 4
+#define EVENT_DECAY_SWEEP_SLOTS 80 // the whole decay wheel is checked for removed items once a second
 
 /**
   * Main Game class.
@@ -216,6 +224,7 @@ class Game
 
 		void addCreatureCheck(Creature* creature);
 		static void removeCreatureCheck(Creature* creature);
+		void wakeCreatureThink(Creature* creature);
 
 		size_t getPlayersOnline() const {
 			return players.size();
@@ -433,7 +442,12 @@ class Game
 		void updateCreatureWalk(uint32_t creatureId);
 		void checkCreatureAttack(uint32_t creatureId);
 		void checkCreatures(size_t index);
+		void planCreatureThink(const std::list<Creature*>& checkCreatureList);
+		void updateCreatureThinkTier(Creature* creature);
+		void updateFlowFields(const std::vector<Creature*>& planList);
+		const FlowField* getFlowField(const Creature* target) const;
 		void checkLight();
+		void checkMapClean();
 
 		bool combatBlockHit(CombatDamage& damage, Creature* attacker, Creature* target, bool checkDefense, bool checkArmor, bool field);
 
@@ -444,9 +458,9 @@ class Game
 
 		//animation help functions
 		void addCreatureHealth(const Creature* target);
-		static void addCreatureHealth(const SpectatorVec& list, const Creature* target);
 		void addMagicEffect(const Position& pos, uint8_t effect);
 		static void addMagicEffect(const SpectatorVec& list, const Position& pos, uint8_t effect);
+		static void addMagicEffect(const SpectatorVec& list, const std::vector<Position>& positions, uint8_t effect);
 		void addDistanceEffect(const Position& fromPos, const Position& toPos, uint8_t effect);
 		static void addDistanceEffect(const SpectatorVec& list, const Position& fromPos, const Position& toPos, uint8_t effect);
 
@@ -454,6 +468,7 @@ class Game
 		void resetCommandTag();
 
 		void startDecay(Item* item);
+		void stopDecay(Item* item);
 		int32_t getLightHour() const {
 			return lightHour;
 		}
@@ -515,22 +530,25 @@ class Game
 		void checkDecay();
 		void internalDecayItem(Item* item);
 
+		void queueCreatureUpdate(const Creature* creature, CreatureUpdate_t update);
+		void sendCreatureUpdates();
+
 		std::unordered_map<uint32_t, Player*> players;
 		std::unordered_map<std::string, Player*> mappedPlayerNames;
 		std::unordered_map<uint32_t, Guild*> guilds;
 		std::unordered_map<uint16_t, Item*> uniqueItems;
+		std::unordered_map<uint32_t, FlowField> flowFields;
+		std::unordered_map<uint32_t, uint8_t> creatureUpdates;
 		std::map<uint32_t, uint32_t> stages;
 
-		std::list<Item*> decayItems[EVENT_DECAY_BUCKETS];
+		DecayWheel decayWheel;
+		std::vector<DecayWheel::Entry> expiredDecayItems;
 		std::list<Creature*> checkCreatureLists[EVENT_CREATURECOUNT];
 
-		std::forward_list<Item*> toDecayItems;
-
 		std::vector<Creature*> ToReleaseCreatures;
 		std::vector<Item*> ToReleaseItems;
 		std::vector<char> commandTags;
 
-		size_t lastBucket;
 
 		WildcardTreeNode wildcardTree;
 
@@ -41,6 +41,8 @@ House::House(uint32_t _houseid) :
 	posEntry.y = 0;
 	posEntry.z = 0;
 	paidUntil = 0;
+	itemsHash = 0;
+	itemsChanged = false;
 	id = _houseid;
 	rentWarnings = 0;
 	rent = 0;
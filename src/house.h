@@ -21,6 +21,7 @@
 #define FS_HOUSE_H_EB9732E7771A438F9CD0EFA8CB4C58C4
 
 #include <regex>
+#include <unordered_set>
 
 #include "container.h"
 #include "housetile.h"
@@ -227,10 +228,30 @@ class House
 			return static_cast<uint32_t>(std::ceil(bedsList.size() / 2.));   //each bed takes 2 sqms of space, ceil is just for bad maps
 		}
 
+		// hash of the tile data last written to tile_store, houses whose
+		// items still hash the same are skipped when saving
+		uint64_t getItemsHash() const {
+			return itemsHash;
+		}
+		void setItemsHash(uint64_t hash) {
+			itemsHash = hash;
+		}
+
+		// set when an item of the house was added, removed or changed, only
+		// these houses are serialized again when saving
+		bool hasChangedItems() const {
+			return itemsChanged;
+		}
+		void setItemsChanged(bool changed) {
+			itemsChanged = changed;
+		}
+
 	private:
 		bool transferToDepot() const;
 		bool transferToDepot(Player* player) const;
 
+		bool itemsChanged;
+
 		AccessList guestList;
 		AccessList subOwnerList;
 
@@ -247,6 +268,8 @@ class House
 
 		time_t paidUntil;
 
+		uint64_t itemsHash;
+
 		uint32_t id;
 		uint32_t owner;
 		uint32_t rentWarnings;
@@ -271,7 +294,7 @@ enum RentPeriod_t {
 class Houses
 {
     public:
-        Houses() = default;
+        Houses() : itemsSaved(false) {}
         ~Houses() {
             for (const auto& it : houseMap) {
                 delete it.second;
@@ -311,8 +334,18 @@ class Houses
 			return houseMap;
 		}
 
+		// false until the house items were saved once, that save rewrites the
+		// whole tile_store table
+		bool areItemsSaved() const {
+			return itemsSaved;
+		}
+		void setItemsSaved() {
+			itemsSaved = true;
+		}
+
 	private:
 		HouseMap houseMap;
+		bool itemsSaved;
 };
 
 #endif
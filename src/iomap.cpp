@@ -30,6 +30,7 @@
 #include "town.h"
 
 #include "bed.h"
+#include "workerpool.h"
 
 /*
 	OTBM_ROOTV1
@@ -69,11 +70,301 @@ Tile* IOMap::createTile(Item*& ground, Item* item, int px, int py, int pz)
 	}
 
 	tile->internalAddThing(ground);
-	ground->startDecaying();
 	ground = nullptr;
 	return tile;
 }
 
+struct LoadedTile {
+	Tile* tile;
+	NODE houseTileNode;
+	// where the items and decaying items of this tile end in its LoadedArea
+	size_t itemsEnd;
+	size_t decayingEnd;
+};
+
+struct LoadedArea {
+	explicit LoadedArea(NODE node) : node(node), base_x(0), base_y(0), base_z(0) {}
+
+	NODE node;
+	int32_t base_x;
+	int32_t base_y;
+	int32_t base_z;
+
+	std::vector<LoadedTile> tiles;
+	// top level items in the order they were read
+	std::vector<Item*> items;
+	// items in the order they would have started decaying
+	std::vector<Item*> decaying;
+
+	std::string error;
+};
+
+void IOMap::registerLoadedItem(Item* item)
+{
+	if (item->hasAttribute(ITEM_ATTRIBUTE_UNIQUEID)) {
+		uint16_t uniqueId = item->getUniqueId();
+		item->removeAttribute(ITEM_ATTRIBUTE_UNIQUEID);
+		item->setUniqueId(uniqueId);
+	}
+
+	BedItem* bed = item->getBed();
+	if (bed && bed->getSleeper() != 0) {
+		bed->registerSleeper();
+	}
+
+	if (Container* container = item->getContainer()) {
+		for (Item* containerItem : container->getItemList()) {
+			registerLoadedItem(containerItem);
+		}
+	}
+}
+
+bool IOMap::parseTileArea(FileLoader& f, LoadedArea& area)
+{
+	PropStream propStream;
+	if (!f.getProps(area.node, propStream)) {
+		setLastErrorString("Invalid map node.");
+		return false;
+	}
+
+	const OTBM_Destination_coords* area_coord;
+	if (!propStream.readStruct(area_coord)) {
+		setLastErrorString("Invalid map node.");
+		return false;
+	}
+
+	area.base_x = area_coord->x;
+	area.base_y = area_coord->y;
+	area.base_z = area_coord->z;
+
+	uint32_t type;
+	NODE nodeTile = f.getChildNode(area.node, type);
+	while (nodeTile != NO_NODE) {
+		if (f.getError() != ERROR_NONE) {
+			setLastErrorString("Could not read node data.");
+			return false;
+		}
+
+		if (type == OTBM_HOUSETILE) {
+			// houses are shared between areas, their tiles are loaded by loadMap
+			area.tiles.push_back({nullptr, nodeTile, area.items.size(), area.decaying.size()});
+		} else if (type != OTBM_TILE) {
+			setLastErrorString("Unknown tile node.");
+			return false;
+		} else if (!parseTile(f, nodeTile, type, area.base_x, area.base_y, area.base_z, nullptr, &area)) {
+			return false;
+		}
+
+		nodeTile = f.getNextNode(nodeTile, type);
+	}
+	return true;
+}
+
+bool IOMap::parseTile(FileLoader& f, NODE nodeTile, uint32_t type, int32_t base_x, int32_t base_y, int32_t base_z, Map* map, LoadedArea* area)
+{
+	PropStream propStream;
+	uint8_t attribute;
+
+	if (!f.getProps(nodeTile, propStream)) {
+		setLastErrorString("Could not read node data.");
+		return false;
+	}
+
+	const OTBM_Tile_coords* tile_coord;
+	if (!propStream.readStruct(tile_coord)) {
+		setLastErrorString("Could not read tile position.");
+		return false;
+	}
+
+	uint16_t px = base_x + tile_coord->x;
+	uint16_t py = base_y + tile_coord->y;
+	uint16_t pz = base_z;
+
+	bool isHouseTile = false;
+	House* house = nullptr;
+	Tile* tile = nullptr;
+	Item* ground_item = nullptr;
+	uint32_t tileflags = TILESTATE_NONE;
+
+	// a worker decoding an area only records what has to be registered with
+	// the game, loadMap does that afterwards in map order
+	auto startDecaying = [area](Item* item) {
+		if (area) {
+			area->decaying.push_back(item);
+		} else {
+			item->startDecaying();
+		}
+	};
+
+	auto addItem = [&](Item* item) {
+		if (area) {
+			area->items.push_back(item);
+		}
+
+		if (tile) {
+			tile->internalAddThing(item);
+			startDecaying(item);
+			item->setLoadedFromMap(true);
+		} else if (item->isGroundTile()) {
+			if (area && ground_item) {
+				area->items.erase(std::find(area->items.rbegin(), area->items.rend(), ground_item).base() - 1);
+			}
+			delete ground_item;
+			ground_item = item;
+		} else {
+			Item* ground = ground_item;
+			tile = createTile(ground_item, item, px, py, pz);
+			if (ground) {
+				startDecaying(ground);
+			}
+			tile->internalAddThing(item);
+			startDecaying(item);
+			item->setLoadedFromMap(true);
+		}
+	};
+
+	if (type == OTBM_HOUSETILE) {
+		uint32_t houseId;
+		if (!propStream.read<uint32_t>(houseId)) {
+			std::ostringstream ss;
+			ss << "[x:" << px << ", y:" << py << ", z:" << pz << "] Could not read house id.";
+			setLastErrorString(ss.str());
+			return false;
+		}
+
+		house = map->houses.addHouse(houseId);
+		if (!house) {
+			std::ostringstream ss;
+			ss << "[x:" << px << ", y:" << py << ", z:" << pz << "] Could not create house id: " << houseId;
+			setLastErrorString(ss.str());
+			return false;
+		}
+
+		tile = new HouseTile(px, py, pz, house);
+		house->addTile(reinterpret_cast<HouseTile*>(tile));
+		isHouseTile = true;
+	}
+
+	//read tile attributes
+	while (propStream.read<uint8_t>(attribute)) {
+		switch (attribute) {
+			case OTBM_ATTR_TILE_FLAGS: {
+				uint32_t flags;
+				if (!propStream.read<uint32_t>(flags)) {
+					std::ostringstream ss;
+					ss << "[x:" << px << ", y:" << py << ", z:" << pz << "] Failed to read tile flags.";
+					setLastErrorString(ss.str());
+					return false;
+				}
+
+				if ((flags & TILESTATE_PROTECTIONZONE) == TILESTATE_PROTECTIONZONE) {
+					tileflags |= TILESTATE_PROTECTIONZONE;
+				} else if ((flags & TILESTATE_NOPVPZONE) == TILESTATE_NOPVPZONE) {
+					tileflags |= TILESTATE_NOPVPZONE;
+				} else if ((flags & TILESTATE_PVPZONE) == TILESTATE_PVPZONE) {
+					tileflags |= TILESTATE_PVPZONE;
+				}
+
+				if ((flags & TILESTATE_NOLOGOUT) == TILESTATE_NOLOGOUT) {
+					tileflags |= TILESTATE_NOLOGOUT;
+				}
+				break;
+			}
+
+			case OTBM_ATTR_ITEM: {
+				Item* item = Item::CreateItem(propStream);
+				if (!item) {
+					std::ostringstream ss;
+					ss << "[x:" << px << ", y:" << py << ", z:" << pz << "] Failed to create item.";
+					setLastErrorString(ss.str());
+					return false;
+				}
+
+				if (isHouseTile && item->isMoveable()) {
+					std::cout << "[Warning - IOMap::loadMap] Moveable item with ID: " << item->getID() << ", in house: " << house->getId() << ", at position [x: " << px << ", y: " << py << ", z: " << pz << "]." << std::endl;
+					delete item;
+					item = nullptr;
+				} else {
+					if (item->getItemCount() <= 0) {
+						item->setItemCount(1);
+					}
+
+					addItem(item);
+				}
+				break;
+			}
+
+			default:
+				std::ostringstream ss;
+				ss << "[x:" << px << ", y:" << py << ", z:" << pz << "] Unknown tile attribute.";
+				setLastErrorString(ss.str());
+				return false;
+		}
+	}
+
+	NODE nodeItem = f.getChildNode(nodeTile, type);
+	while (nodeItem) {
+		if (type != OTBM_ITEM) {
+			std::ostringstream ss;
+			ss << "[x:" << px << ", y:" << py << ", z:" << pz << "] Unknown node type.";
+			setLastErrorString(ss.str());
+			return false;
+		}
+
+		PropStream stream;
+		if (!f.getProps(nodeItem, stream)) {
+			setLastErrorString("Invalid item node.");
+			return false;
+		}
+
+		Item* item = Item::CreateItem(stream);
+		if (!item) {
+			std::ostringstream ss;
+			ss << "[x:" << px << ", y:" << py << ", z:" << pz << "] Failed to create item.";
+			setLastErrorString(ss.str());
+			return false;
+		}
+
+		if (!item->unserializeItemNode(f, nodeItem, stream)) {
+			std::ostringstream ss;
+			ss << "[x:" << px << ", y:" << py << ", z:" << pz << "] Failed to load item " << item->getID() << '.';
+			setLastErrorString(ss.str());
+			delete item;
+			return false;
+		}
+
+		if (isHouseTile && item->isMoveable()) {
+			std::cout << "[Warning - IOMap::loadMap] Moveable item with ID: " << item->getID() << ", in house: " << house->getId() << ", at position [x: " << px << ", y: " << py << ", z: " << pz << "]." << std::endl;
+			delete item;
+		} else {
+			if (item->getItemCount() <= 0) {
+				item->setItemCount(1);
+			}
+
+			addItem(item);
+		}
+
+		nodeItem = f.getNextNode(nodeItem, type);
+	}
+
+	if (!tile) {
+		Item* ground = ground_item;
+		tile = createTile(ground_item, nullptr, px, py, pz);
+		if (ground) {
+			startDecaying(ground);
+		}
+	}
+
+	tile->setFlag(static_cast<tileflags_t>(tileflags));
+
+	if (area) {
+		area->tiles.push_back({tile, NO_NODE, area->items.size(), area->decaying.size()});
+	} else {
+		map->setTile(px, py, pz, tile);
+	}
+	return true;
+}
+
 bool IOMap::loadMap(Map* map, const std::string& identifier)
 {
 	int64_t start = OTSYS_TIME();
@@ -151,6 +442,7 @@ bool IOMap::loadMap(Map* map, const std::string& identifier)
 
 	std::string mapDescription;
 	std::string tmp;
+	std::vector<LoadedArea> areas;
 
 	uint8_t attribute;
 	while (propStream.read<uint8_t>(attribute)) {
@@ -196,212 +488,7 @@ bool IOMap::loadMap(Map* map, const std::string& identifier)
 		}
 
 		if (type == OTBM_TILE_AREA) {
-			if (!f.getProps(nodeMapData, propStream)) {
-				setLastErrorString("Invalid map node.");
-				return false;
-			}
-
-			const OTBM_Destination_coords* area_coord;
-			if (!propStream.readStruct(area_coord)) {
-				setLastErrorString("Invalid map node.");
-				return false;
-			}
-
-			int32_t base_x = area_coord->x;
-			int32_t base_y = area_coord->y;
-			int32_t base_z = area_coord->z;
-
-			NODE nodeTile = f.getChildNode(nodeMapData, type);
-			while (nodeTile != NO_NODE) {
-				if (f.getError() != ERROR_NONE) {
-					setLastErrorString("Could not read node data.");
-					return false;
-				}
-
-				if (type != OTBM_TILE && type != OTBM_HOUSETILE) {
-					setLastErrorString("Unknown tile node.");
-					return false;
-				}
-
-				if (!f.getProps(nodeTile, propStream)) {
-					setLastErrorString("Could not read node data.");
-					return false;
-				}
-
-				const OTBM_Tile_coords* tile_coord;
-				if (!propStream.readStruct(tile_coord)) {
-					setLastErrorString("Could not read tile position.");
-					return false;
-				}
-
-				uint16_t px = base_x + tile_coord->x;
-				uint16_t py = base_y + tile_coord->y;
-				uint16_t pz = base_z;
-
-				bool isHouseTile = false;
-				House* house = nullptr;
-				Tile* tile = nullptr;
-				Item* ground_item = nullptr;
-				uint32_t tileflags = TILESTATE_NONE;
-
-				if (type == OTBM_HOUSETILE) {
-					uint32_t houseId;
-					if (!propStream.read<uint32_t>(houseId)) {
-						std::ostringstream ss;
-						ss << "[x:" << px << ", y:" << py << ", z:" << pz << "] Could not read house id.";
-						setLastErrorString(ss.str());
-						return false;
-					}
-
-					house = map->houses.addHouse(houseId);
-					if (!house) {
-						std::ostringstream ss;
-						ss << "[x:" << px << ", y:" << py << ", z:" << pz << "] Could not create house id: " << houseId;
-						setLastErrorString(ss.str());
-						return false;
-					}
-
-					tile = new HouseTile(px, py, pz, house);
-					house->addTile(reinterpret_cast<HouseTile*>(tile));
-					isHouseTile = true;
-				}
-
-				//read tile attributes
-				while (propStream.read<uint8_t>(attribute)) {
-					switch (attribute) {
-						case OTBM_ATTR_TILE_FLAGS: {
-							uint32_t flags;
-							if (!propStream.read<uint32_t>(flags)) {
-								std::ostringstream ss;
-								ss << "[x:" << px << ", y:" << py << ", z:" << pz << "] Failed to read tile flags.";
-								setLastErrorString(ss.str());
-								return false;
-							}
-
-							if ((flags & TILESTATE_PROTECTIONZONE) == TILESTATE_PROTECTIONZONE) {
-								tileflags |= TILESTATE_PROTECTIONZONE;
-							} else if ((flags & TILESTATE_NOPVPZONE) == TILESTATE_NOPVPZONE) {
-								tileflags |= TILESTATE_NOPVPZONE;
-							} else if ((flags & TILESTATE_PVPZONE) == TILESTATE_PVPZONE) {
-								tileflags |= TILESTATE_PVPZONE;
-							}
-
-							if ((flags & TILESTATE_NOLOGOUT) == TILESTATE_NOLOGOUT) {
-								tileflags |= TILESTATE_NOLOGOUT;
-							}
-							break;
-						}
-
-						case OTBM_ATTR_ITEM: {
-							Item* item = Item::CreateItem(propStream);
-							if (!item) {
-								std::ostringstream ss;
-								ss << "[x:" << px << ", y:" << py << ", z:" << pz << "] Failed to create item.";
-								setLastErrorString(ss.str());
-								return false;
-							}
-
-							if (isHouseTile && item->isMoveable()) {
-								std::cout << "[Warning - IOMap::loadMap] Moveable item with ID: " << item->getID() << ", in house: " << house->getId() << ", at position [x: " << px << ", y: " << py << ", z: " << pz << "]." << std::endl;
-								delete item;
-								item = nullptr;
-							} else {
-								if (item->getItemCount() <= 0) {
-									item->setItemCount(1);
-								}
-
-								if (tile) {
-									tile->internalAddThing(item);
-									item->startDecaying();
-									item->setLoadedFromMap(true);
-								} else if (item->isGroundTile()) {
-									delete ground_item;
-									ground_item = item;
-								} else {
-									tile = createTile(ground_item, item, px, py, pz);
-									tile->internalAddThing(item);
-									item->startDecaying();
-									item->setLoadedFromMap(true);
-								}
-							}
-							break;
-						}
-
-						default:
-							std::ostringstream ss;
-							ss << "[x:" << px << ", y:" << py << ", z:" << pz << "] Unknown tile attribute.";
-							setLastErrorString(ss.str());
-							return false;
-					}
-				}
-
-				NODE nodeItem = f.getChildNode(nodeTile, type);
-				while (nodeItem) {
-					if (type != OTBM_ITEM) {
-						std::ostringstream ss;
-						ss << "[x:" << px << ", y:" << py << ", z:" << pz << "] Unknown node type.";
-						setLastErrorString(ss.str());
-						return false;
-					}
-
-					PropStream stream;
-					if (!f.getProps(nodeItem, stream)) {
-						setLastErrorString("Invalid item node.");
-						return false;
-					}
-
-					Item* item = Item::CreateItem(stream);
-					if (!item) {
-						std::ostringstream ss;
-						ss << "[x:" << px << ", y:" << py << ", z:" << pz << "] Failed to create item.";
-						setLastErrorString(ss.str());
-						return false;
-					}
-
-					if (!item->unserializeItemNode(f, nodeItem, stream)) {
-						std::ostringstream ss;
-						ss << "[x:" << px << ", y:" << py << ", z:" << pz << "] Failed to load item " << item->getID() << '.';
-						setLastErrorString(ss.str());
-						delete item;
-						return false;
-					}
-
-					if (isHouseTile && item->isMoveable()) {
-						std::cout << "[Warning - IOMap::loadMap] Moveable item with ID: " << item->getID() << ", in house: " << house->getId() << ", at position [x: " << px << ", y: " << py << ", z: " << pz << "]." << std::endl;
-						delete item;
-					} else {
-						if (item->getItemCount() <= 0) {
-							item->setItemCount(1);
-						}
-
-						if (tile) {
-							tile->internalAddThing(item);
-							item->startDecaying();
-							item->setLoadedFromMap(true);
-						} else if (item->isGroundTile()) {
-							delete ground_item;
-							ground_item = item;
-						} else {
-							tile = createTile(ground_item, item, px, py, pz);
-							tile->internalAddThing(item);
-							item->startDecaying();
-							item->setLoadedFromMap(true);
-						}
-					}
-
-					nodeItem = f.getNextNode(nodeItem, type);
-				}
-
-				if (!tile) {
-					tile = createTile(ground_item, nullptr, px, py, pz);
-				}
-
-				tile->setFlag(static_cast<tileflags_t>(tileflags));
-
-				map->setTile(px, py, pz, tile);
-
-				nodeTile = f.getNextNode(nodeTile, type);
-			}
+			areas.emplace_back(nodeMapData);
 		} else if (type == OTBM_TOWNS) {
 			NODE nodeTown = f.getChildNode(nodeMapData, type);
 			while (nodeTown != NO_NODE) {
@@ -482,6 +569,52 @@ bool IOMap::loadMap(Map* map, const std::string& identifier)
 		nodeMapData = f.getNextNode(nodeMapData, type);
 	}
 
+	// tile areas are decoded in parallel, everything that has to be registered
+	// with the map or the game is then done here in map order
+	Item::deferRegistration = true;
+	g_workerPool.parallelFor(areas.size(), [&f, &areas](size_t i) {
+		LoadedArea& area = areas[i];
+
+		FileLoader areaFile;
+		areaFile.openFile(f);
+
+		IOMap areaLoader;
+		if (!areaLoader.parseTileArea(areaFile, area)) {
+			area.error = areaLoader.getLastErrorString();
+		}
+	});
+	Item::deferRegistration = false;
+
+	for (const LoadedArea& area : areas) {
+		if (!area.error.empty()) {
+			setLastErrorString(area.error);
+			return false;
+		}
+
+		size_t itemIndex = 0;
+		size_t decayingIndex = 0;
+		for (const LoadedTile& loadedTile : area.tiles) {
+			if (loadedTile.houseTileNode) {
+				if (!parseTile(f, loadedTile.houseTileNode, OTBM_HOUSETILE, area.base_x, area.base_y, area.base_z, map, nullptr)) {
+					return false;
+				}
+				continue;
+			}
+
+			for (; itemIndex < loadedTile.itemsEnd; ++itemIndex) {
+				registerLoadedItem(area.items[itemIndex]);
+			}
+
+			for (; decayingIndex < loadedTile.decayingEnd; ++decayingIndex) {
+				area.decaying[decayingIndex]->startDecaying();
+			}
+
+			map->setTile(loadedTile.tile->getPosition(), loadedTile.tile);
+		}
+	}
+
 	std::cout << "> Map loading time: " << (OTSYS_TIME() - start) / (1000.) << " seconds." << std::endl;
+	std::cout << "> Tile memory: " << TileAllocator::getUsedBytes() / (1024 * 1024) << " MB used, " << TileAllocator::getAllocatedBytes() / (1024 * 1024) << " MB allocated." << std::endl;
+	std::cout << "> Item memory: " << ItemAllocator::getUsedBytes() / (1024 * 1024) << " MB used, " << ItemAllocator::getAllocatedBytes() / (1024 * 1024) << " MB allocated." << std::endl;
 	return true;
 }
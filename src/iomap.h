@@ -101,12 +101,20 @@ struct OTBM_HouseTile_coords {
 
 #pragma pack()
 
+struct LoadedArea;
+
 class IOMap
 {
 		static Tile* createTile(Item*& ground, Item* item, int px, int py, int pz);
+
+		bool parseTileArea(FileLoader& f, LoadedArea& area);
+		bool parseTile(FileLoader& f, NODE nodeTile, uint32_t type, int32_t base_x, int32_t base_y, int32_t base_z, Map* map, LoadedArea* area);
 	public:
 		bool loadMap(Map* map, const std::string& identifier);
 
+		// registers what Item::deferRegistration held back for an item and its contents
+		static void registerLoadedItem(Item* item);
+
 		/* Load the spawns
 		 * \param map pointer to the Map class
 		 * \returns Returns true if the spawns were loaded successfully
@@ -23,13 +23,37 @@
 #include "house.h"
 #include "game.h"
 #include "bed.h"
+#include "iomap.h"
+#include "workerpool.h"
 
 extern Game g_game;
 
+struct LoadedHouseItem {
+	// decoded item, or nullptr for a stationary item which is read again
+	// from offset when it is attached, as it updates an item of the map
+	Item* item;
+	size_t offset;
+	// where the items that start decaying with this one end in LoadedHouseTile::decaying
+	size_t decayingEnd;
+};
+
+struct LoadedHouseTile {
+	explicit LoadedHouseTile(std::string data) : data(std::move(data)), tile(nullptr) {}
+
+	std::string data;
+	Tile* tile;
+
+	std::vector<LoadedHouseItem> items;
+	// container contents and items, in the order they would have started decaying
+	std::vector<Item*> decaying;
+};
+
 void IOMapSerialize::loadHouseItems(Map* map)
 {
 	int64_t start = OTSYS_TIME();
 
+	std::vector<LoadedHouseTile> tiles;
+
 	DBResult_ptr result = Database::getInstance()->storeQuery("SELECT `data` FROM `tile_store`");
 	if (!result) {
 		return;
@@ -38,31 +62,132 @@ void IOMapSerialize::loadHouseItems(Map* map)
 	do {
 		unsigned long attrSize;
 		const char* attr = result->getStream("data", attrSize);
+		tiles.emplace_back(std::string(attr, attrSize));
+	} while (result->next());
+	result.reset();
+
+	int64_t fetched = OTSYS_TIME();
+
+	// rows are decoded into detached items in parallel, everything that
+	// touches the map or the game is then done here in row order
+	Item::deferRegistration = true;
+	g_workerPool.parallelFor(tiles.size(), [&tiles, map](size_t i) {
+		parseHouseTile(tiles[i], map);
+	});
+	Item::deferRegistration = false;
 
-		PropStream propStream;
-		propStream.init(attr, attrSize);
+	int64_t decoded = OTSYS_TIME();
 
-		uint16_t x, y;
-		uint8_t z;
-		if (!propStream.read<uint16_t>(x) || !propStream.read<uint16_t>(y) || !propStream.read<uint8_t>(z)) {
+	for (LoadedHouseTile& loadedTile : tiles) {
+		if (!loadedTile.tile) {
 			continue;
 		}
 
-		Tile* tile = map->getTile(x, y, z);
-		if (!tile) {
-			continue;
+		size_t decayingIndex = 0;
+		for (const LoadedHouseItem& loadedItem : loadedTile.items) {
+			if (loadedItem.item) {
+				IOMap::registerLoadedItem(loadedItem.item);
+				loadedTile.tile->internalAddThing(loadedItem.item);
+			} else {
+				PropStream propStream;
+				propStream.init(loadedTile.data.data() + loadedItem.offset, loadedTile.data.size() - loadedItem.offset);
+				loadItem(propStream, loadedTile.tile);
+			}
+
+			for (; decayingIndex < loadedItem.decayingEnd; ++decayingIndex) {
+				loadedTile.decaying[decayingIndex]->startDecaying();
+			}
 		}
+	}
 
-		uint32_t item_count;
-		if (!propStream.read<uint32_t>(item_count)) {
-			continue;
+	std::cout << "> Loaded house items in: " << (OTSYS_TIME() - start) / (1000.) << " s (fetch "
+	          << (fetched - start) / (1000.) << " s, decode " << (decoded - fetched) / (1000.)
+	          << " s, attach " << (OTSYS_TIME() - decoded) / (1000.) << " s)" << std::endl;
+}
+
+void IOMapSerialize::parseHouseTile(LoadedHouseTile& loadedTile, Map* map)
+{
+	PropStream propStream;
+	propStream.init(loadedTile.data.data(), loadedTile.data.size());
+
+	uint16_t x, y;
+	uint8_t z;
+	if (!propStream.read<uint16_t>(x) || !propStream.read<uint16_t>(y) || !propStream.read<uint8_t>(z)) {
+		return;
+	}
+
+	Tile* tile = map->getTile(x, y, z);
+	if (!tile) {
+		return;
+	}
+
+	uint32_t item_count;
+	if (!propStream.read<uint32_t>(item_count)) {
+		return;
+	}
+	loadedTile.tile = tile;
+
+	while (item_count--) {
+		const size_t offset = loadedTile.data.size() - propStream.size();
+
+		uint16_t id;
+		if (!propStream.read<uint16_t>(id)) {
+			break;
 		}
 
-		while (item_count--) {
-			loadItem(propStream, tile);
+		if (Item::items[id].moveable) {
+			const size_t decayingBegin = loadedTile.decaying.size();
+
+			//create a new item
+			Item* item = Item::CreateItem(id);
+			if (!item) {
+				continue;
+			}
+
+			if (!item->unserializeAttr(propStream)) {
+				std::cout << "WARNING: Unserialization error in IOMapSerialize::loadItem()" << id << std::endl;
+				delete item;
+				continue;
+			}
+
+			Container* container = item->getContainer();
+			if (container && !loadContainer(propStream, container, &loadedTile.decaying)) {
+				loadedTile.decaying.resize(decayingBegin);
+				delete item;
+				continue;
+			}
+
+			loadedTile.decaying.push_back(item);
+			loadedTile.items.push_back({item, offset, loadedTile.decaying.size()});
+		} else {
+			// stationary items like doors/beds/blackboards/bookcases, only
+			// skipped here as their attributes go to an item of the map
+			loadedTile.items.push_back({nullptr, offset, loadedTile.decaying.size()});
+
+			std::unique_ptr<Item> dummy(Item::CreateItem(id));
+			if (dummy) {
+				dummy->unserializeAttr(propStream);
+				Container* container = dummy->getContainer();
+				if (container) {
+					std::vector<Item*> dummyDecaying;
+					loadContainer(propStream, container, &dummyDecaying);
+				}
+			}
 		}
-	} while (result->next());
-	std::cout << "> Loaded house items in: " << (OTSYS_TIME() - start) / (1000.) << " s" << std::endl;
+	}
+}
+
+static uint64_t hashTileData(uint64_t hash, const char* data, size_t size)
+{
+	// FNV-1a, the size goes in first so that tile boundaries count too
+	for (size_t i = 0; i < sizeof(size); ++i) {
+		hash = (hash ^ ((size >> (i * 8)) & 0xFF)) * 1099511628211ULL;
+	}
+
+	for (size_t i = 0; i < size; ++i) {
+		hash = (hash ^ static_cast<uint8_t>(data[i])) * 1099511628211ULL;
+	}
+	return hash;
 }
 
 bool IOMapSerialize::saveHouseItems()
@@ -71,36 +196,102 @@ bool IOMapSerialize::saveHouseItems()
 	Database* db = Database::getInstance();
 	std::ostringstream query;
 
-	//Start the transaction
-	DBTransaction transaction;
-	if (!transaction.begin()) {
-		return false;
-	}
-
-	//clear old tile data
-	if (!db->executeQuery("DELETE FROM `tile_store`")) {
-		return false;
-	}
+	// the first save after startup rewrites the whole table, which also drops
+	// rows of houses that are no longer on the map; later saves only
+	// serialize the houses whose items were touched since or are decaying
+	// and rewrite those whose tile data really differs
+	Houses& houses = g_game.map.houses;
+	const bool savedOnce = houses.areItemsSaved();
 
-	DBInsert stmt("INSERT INTO `tile_store` (`house_id`, `data`) VALUES ");
+	std::vector<std::pair<House*, uint64_t>> changedHouses;
+	std::vector<House*> settledHouses;
+	std::vector<std::pair<uint32_t, std::string>> rows;
+	size_t bytes = 0;
 
 	PropWriteStream stream;
-	for (const auto& it : g_game.map.houses.getHouses()) {
+	for (const auto& it : houses.getHouses()) {
 		//save house items
 		House* house = it.second;
+		if (savedOnce && !house->hasChangedItems()) {
+			continue;
+		}
+
+		const size_t firstRow = rows.size();
+		bool decaying = false;
+
+		uint64_t hash = 14695981039346656037ULL;
 		for (HouseTile* tile : house->getTiles()) {
-			saveTile(stream, tile);
+			saveTile(stream, tile, &decaying);
 
 			size_t attributesSize;
 			const char* attributes = stream.getStream(attributesSize);
 			if (attributesSize > 0) {
-				query << house->getId() << ',' << db->escapeBlob(attributes, attributesSize);
-				if (!stmt.addRow(query)) {
-					return false;
-				}
+				hash = hashTileData(hash, attributes, attributesSize);
+				rows.emplace_back(house->getId(), std::string(attributes, attributesSize));
 				stream.clear();
 			}
 		}
+
+		// the time left of decaying items changes without notifications, so
+		// such houses stay flagged until nothing in them decays anymore
+		if (!decaying) {
+			settledHouses.push_back(house);
+		}
+
+		if (savedOnce && hash == house->getItemsHash()) {
+			rows.resize(firstRow);
+			continue;
+		}
+
+		changedHouses.emplace_back(house, hash);
+		for (size_t i = firstRow; i < rows.size(); ++i) {
+			bytes += rows[i].second.size();
+		}
+	}
+
+	if (changedHouses.empty()) {
+		for (House* house : settledHouses) {
+			house->setItemsChanged(false);
+		}
+
+		std::cout << "> Saved house items in: " << (OTSYS_TIME() - start) / (1000.) << " s (no house changed)" << std::endl;
+		return true;
+	}
+
+	//Start the transaction
+	DBTransaction transaction;
+	if (!transaction.begin()) {
+		return false;
+	}
+
+	//clear old tile data
+	if (!savedOnce) {
+		if (!db->executeQuery("DELETE FROM `tile_store`")) {
+			return false;
+		}
+	} else {
+		query << "DELETE FROM `tile_store` WHERE `house_id` IN (";
+		for (size_t i = 0; i < changedHouses.size(); ++i) {
+			if (i != 0) {
+				query << ',';
+			}
+			query << changedHouses[i].first->getId();
+		}
+		query << ')';
+
+		if (!db->executeQuery(query.str())) {
+			return false;
+		}
+		query.str(std::string());
+	}
+
+	DBInsert stmt("INSERT INTO `tile_store` (`house_id`, `data`) VALUES ");
+
+	for (const auto& row : rows) {
+		query << row.first << ',' << db->escapeBlob(row.second.data(), row.second.size());
+		if (!stmt.addRow(query)) {
+			return false;
+		}
 	}
 
 	if (!stmt.execute()) {
@@ -109,15 +300,25 @@ bool IOMapSerialize::saveHouseItems()
 
 	//End the transaction
 	bool success = transaction.commit();
-	std::cout << "> Saved house items in: " <<
-	          (OTSYS_TIME() - start) / (1000.) << " s" << std::endl;
+	if (success) {
+		houses.setItemsSaved();
+		for (House* house : settledHouses) {
+			house->setItemsChanged(false);
+		}
+		for (const auto& it : changedHouses) {
+			it.first->setItemsHash(it.second);
+		}
+	}
+
+	std::cout << "> Saved house items of " << changedHouses.size() << " of " << houses.getHouses().size()
+	          << " houses (" << bytes / 1024 << " kB) in: " << (OTSYS_TIME() - start) / (1000.) << " s" << std::endl;
 	return success;
 }
 
-bool IOMapSerialize::loadContainer(PropStream& propStream, Container* container)
+bool IOMapSerialize::loadContainer(PropStream& propStream, Container* container, std::vector<Item*>* decaying/* = nullptr*/)
 {
 	while (container->serializationCount > 0) {
-		if (!loadItem(propStream, container)) {
+		if (!loadItem(propStream, container, decaying)) {
 			std::cout << "[Warning - IOMapSerialize::loadContainer] Unserialization error for container item: " << container->getID() << std::endl;
 			return false;
 		}
@@ -132,7 +333,7 @@ bool IOMapSerialize::loadContainer(PropStream& propStream, Container* container)
 	return true;
 }
 
-bool IOMapSerialize::loadItem(PropStream& propStream, Cylinder* parent)
+bool IOMapSerialize::loadItem(PropStream& propStream, Cylinder* parent, std::vector<Item*>* decaying/* = nullptr*/)
 {
 	uint16_t id;
 	if (!propStream.read<uint16_t>(id)) {
@@ -151,13 +352,17 @@ bool IOMapSerialize::loadItem(PropStream& propStream, Cylinder* parent)
 		if (item) {
 			if (item->unserializeAttr(propStream)) {
 				Container* container = item->getContainer();
-				if (container && !loadContainer(propStream, container)) {
+				if (container && !loadContainer(propStream, container, decaying)) {
 					delete item;
 					return false;
 				}
 
 				parent->internalAddThing(item);
-				item->startDecaying();
+				if (decaying) {
+					decaying->push_back(item);
+				} else {
+					item->startDecaying();
+				}
 			} else {
 				std::cout << "WARNING: Unserialization error in IOMapSerialize::loadItem()" << id << std::endl;
 				delete item;
@@ -215,9 +420,12 @@ bool IOMapSerialize::loadItem(PropStream& propStream, Cylinder* parent)
 	return true;
 }
 
-void IOMapSerialize::saveItem(PropWriteStream& stream, const Item* item)
+void IOMapSerialize::saveItem(PropWriteStream& stream, const Item* item, bool* decaying/* = nullptr*/)
 {
 	const Container* container = item->getContainer();
+	if (decaying && item->getDecaying() == DECAYING_TRUE) {
+		*decaying = true;
+	}
 
 	// Write ID & props
 	stream.write<uint16_t>(item->getID());
@@ -228,14 +436,14 @@ void IOMapSerialize::saveItem(PropWriteStream& stream, const Item* item)
 		stream.write<uint8_t>(ATTR_CONTAINER_ITEMS);
 		stream.write<uint32_t>(container->size());
 		for (ItemDeque::const_reverse_iterator it = container->getReversedItems(), end = container->getReversedEnd(); it != end; ++it) {
-			saveItem(stream, *it);
+			saveItem(stream, *it, decaying);
 		}
 	}
 
 	stream.write<uint8_t>(0x00); // attr end
 }
 
-void IOMapSerialize::saveTile(PropWriteStream& stream, const Tile* tile)
+void IOMapSerialize::saveTile(PropWriteStream& stream, const Tile* tile, bool* decaying/* = nullptr*/)
 {
 	const TileItemVector* tileItems = tile->getItemList();
 	if (!tileItems) {
@@ -264,7 +472,7 @@ void IOMapSerialize::saveTile(PropWriteStream& stream, const Tile* tile)
 
 		stream.write<uint32_t>(count);
 		for (const Item* item : items) {
-			saveItem(stream, item);
+			saveItem(stream, item, decaying);
 		}
 	}
 }
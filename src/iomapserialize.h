@@ -23,6 +23,8 @@
 #include "database.h"
 #include "map.h"
 
+struct LoadedHouseTile;
+
 class IOMapSerialize
 {
 	public:
@@ -32,11 +34,12 @@ class IOMapSerialize
 		static bool saveHouseInfo();
 
 	protected:
-		static void saveItem(PropWriteStream& stream, const Item* item);
-		static void saveTile(PropWriteStream& stream, const Tile* tile);
+		static void saveItem(PropWriteStream& stream, const Item* item, bool* decaying = nullptr);
+		static void saveTile(PropWriteStream& stream, const Tile* tile, bool* decaying = nullptr);
 
-		static bool loadContainer(PropStream& propStream, Container* container);
-		static bool loadItem(PropStream& propStream, Cylinder* parent);
+		static bool loadContainer(PropStream& propStream, Container* container, std::vector<Item*>* decaying = nullptr);
+		static bool loadItem(PropStream& propStream, Cylinder* parent, std::vector<Item*>* decaying = nullptr);
+		static void parseHouseTile(LoadedHouseTile& loadedTile, Map* map);
 };
 
 #endif
@@ -31,11 +31,41 @@
 
 #include "actions.h"
 #include "combat.h"
+#include "chunkpool.h"
 
 extern Game g_game;
 
 Items Item::items;
 
+static ChunkPool& getItemChunkPool()
+{
+	// intentionally leaked, map items are destroyed along with the map at
+	// exit and that must not depend on static destruction order
+	static ChunkPool* pool = new ChunkPool;
+	return *pool;
+}
+
+void* ItemAllocator::allocate(size_t size)
+{
+	return getItemChunkPool().allocate(size);
+}
+
+void ItemAllocator::deallocate(void* p, size_t size)
+{
+	getItemChunkPool().deallocate(p, size);
+}
+
+size_t ItemAllocator::getAllocatedBytes()
+{
+	return getItemChunkPool().getAllocatedBytes();
+}
+
+size_t ItemAllocator::getUsedBytes()
+{
+	return getItemChunkPool().getUsedBytes();
+}
+bool Item::deferRegistration = false;
+
 Item* Item::CreateItem(const uint16_t _type, uint16_t _count /*= 0*/)
 {
 	Item* newItem = nullptr;
@@ -221,21 +251,16 @@ bool Item::equals(const Item* otherItem) const
 		return false;
 	}
 
-	const auto& attributeList = attributes->attributes;
-	const auto& otherAttributeList = otherAttributes->attributes;
-	for (const auto& attribute : attributeList) {
-		if (ItemAttributes::isStrAttrType(attribute.type)) {
-			for (const auto& otherAttribute : otherAttributeList) {
-				if (attribute.type == otherAttribute.type && *attribute.value.string != *otherAttribute.value.string) {
-					return false;
-				}
-			}
-		} else {
-			for (const auto& otherAttribute : otherAttributeList) {
-				if (attribute.type == otherAttribute.type && attribute.value.integer != otherAttribute.value.integer) {
-					return false;
-				}
+	for (uint32_t bits = attributes->attributeBits; bits != 0; bits &= bits - 1) {
+		itemAttrTypes type = static_cast<itemAttrTypes>(bits & (~bits + 1));
+		const ItemAttributes::Value& value = attributes->getValueAt(attributes->getIndex(type));
+		const ItemAttributes::Value& otherValue = otherAttributes->getValueAt(otherAttributes->getIndex(type));
+		if (ItemAttributes::isStrAttrType(type)) {
+			if (*value.string != *otherValue.string) {
+				return false;
 			}
+		} else if (value.integer != otherValue.integer) {
+			return false;
 		}
 	}
 	return true;
@@ -273,6 +298,11 @@ void Item::setID(uint16_t newid)
 	const ItemType& it = Item::items[newid];
 	uint32_t newDuration = it.decayTime * 1000;
 
+	if (newDuration == 0) {
+		// the wheel entry of the old type must not fire, a stopTime item keeps the time left
+		g_game.stopDecay(this);
+	}
+
 	if (newDuration == 0 && !it.stopTime && it.decayTo < 0) {
 		removeAttribute(ITEM_ATTRIBUTE_DECAYSTATE);
 		removeAttribute(ITEM_ATTRIBUTE_DURATION);
@@ -1472,6 +1502,11 @@ void Item::setUniqueId(uint16_t n)
 		return;
 	}
 
+	if (deferRegistration) {
+		getAttributes()->setUniqueId(n);
+		return;
+	}
+
 	if (g_game.addUniqueItem(n, this)) {
 		getAttributes()->setUniqueId(n);
 	}
@@ -1521,17 +1556,60 @@ void Item::getLight(LightInfo& lightInfo) const
 
 std::string ItemAttributes::emptyString;
 
-const std::string& ItemAttributes::getStrAttr(itemAttrTypes type) const
+ItemAttributes::ItemAttributes(const ItemAttributes& other) :
+	firstValue(other.firstValue), otherValues(nullptr), attributeBits(other.attributeBits)
 {
-	if (!isStrAttrType(type)) {
-		return emptyString;
+	size_t count = getCount();
+	if (count > 1) {
+		otherValues = new Value[count - 1];
+		std::copy(other.otherValues, other.otherValues + count - 1, otherValues);
+	}
+
+	for (uint32_t bits = attributeBits; bits != 0; bits &= bits - 1) {
+		itemAttrTypes type = static_cast<itemAttrTypes>(bits & (~bits + 1));
+		if (isStrAttrType(type)) {
+			Value& value = getValueAt(getIndex(type));
+			value.string = new std::string(*value.string);
+		}
+	}
+}
+
+ItemAttributes::~ItemAttributes()
+{
+	for (uint32_t bits = attributeBits; bits != 0; bits &= bits - 1) {
+		itemAttrTypes type = static_cast<itemAttrTypes>(bits & (~bits + 1));
+		if (isStrAttrType(type)) {
+			delete getValueAt(getIndex(type)).string;
+		}
+	}
+	delete[] otherValues;
+}
+
+void ItemAttributes::setValues(const Value* values, size_t count)
+{
+	// attributes are set rarely and items only have a few of them, so the
+	// values beyond the first are kept in an array of exactly their size
+	delete[] otherValues;
+	otherValues = nullptr;
+
+	if (count == 0) {
+		firstValue.integer = 0;
+		return;
+	}
+
+	firstValue = values[0];
+	if (count > 1) {
+		otherValues = new Value[count - 1];
+		std::copy(values + 1, values + count, otherValues);
 	}
+}
 
-	const Attribute* attr = getExistingAttr(type);
-	if (!attr) {
+const std::string& ItemAttributes::getStrAttr(itemAttrTypes type) const
+{
+	if (!isStrAttrType(type) || !hasAttribute(type)) {
 		return emptyString;
 	}
-	return *attr->value.string;
+	return *getValueAt(getIndex(type)).string;
 }
 
 void ItemAttributes::setStrAttr(itemAttrTypes type, const std::string& value)
@@ -1544,9 +1622,9 @@ void ItemAttributes::setStrAttr(itemAttrTypes type, const std::string& value)
 		return;
 	}
 
-	Attribute& attr = getAttr(type);
-	delete attr.value.string;
-	attr.value.string = new std::string(value);
+	Value& attr = getValue(type);
+	delete attr.string;
+	attr.string = new std::string(value);
 }
 
 void ItemAttributes::removeAttribute(itemAttrTypes type)
@@ -1555,33 +1633,28 @@ void ItemAttributes::removeAttribute(itemAttrTypes type)
 		return;
 	}
 
-	auto prev_it = attributes.cbegin();
-	if ((*prev_it).type == type) {
-		attributes.pop_front();
-	} else {
-		auto it = prev_it, end = attributes.cend();
-		while (++it != end) {
-			if ((*it).type == type) {
-				attributes.erase_after(prev_it);
-				break;
-			}
-			prev_it = it;
+	size_t index = getIndex(type);
+	if (isStrAttrType(type)) {
+		delete getValueAt(index).string;
+	}
+
+	Value values[32];
+	size_t count = getCount();
+	for (size_t i = 0, j = 0; i < count; ++i) {
+		if (i != index) {
+			values[j++] = getValueAt(i);
 		}
 	}
+	setValues(values, count - 1);
 	attributeBits &= ~type;
 }
 
 int64_t ItemAttributes::getIntAttr(itemAttrTypes type) const
 {
-	if (!isIntAttrType(type)) {
+	if (!isIntAttrType(type) || !hasAttribute(type)) {
 		return 0;
 	}
-
-	const Attribute* attr = getExistingAttr(type);
-	if (!attr) {
-		return 0;
-	}
-	return attr->value.integer;
+	return getValueAt(getIndex(type)).integer;
 }
 
 void ItemAttributes::setIntAttr(itemAttrTypes type, int64_t value)
@@ -1590,7 +1663,7 @@ void ItemAttributes::setIntAttr(itemAttrTypes type, int64_t value)
 		return;
 	}
 
-	getAttr(type).value.integer = value;
+	getValue(type).integer = value;
 }
 
 void ItemAttributes::increaseIntAttr(itemAttrTypes type, int64_t value)
@@ -1599,34 +1672,69 @@ void ItemAttributes::increaseIntAttr(itemAttrTypes type, int64_t value)
 		return;
 	}
 
-	getAttr(type).value.integer += value;
+	getValue(type).integer += value;
 }
 
-const ItemAttributes::Attribute* ItemAttributes::getExistingAttr(itemAttrTypes type) const
+ItemAttributes::Value& ItemAttributes::getValue(itemAttrTypes type)
 {
+	size_t index = getIndex(type);
 	if (hasAttribute(type)) {
-		for (const Attribute& attribute : attributes) {
-			if (attribute.type == type) {
-				return &attribute;
-			}
+		return getValueAt(index);
+	}
+
+	Value values[32];
+	size_t count = getCount();
+	for (size_t i = 0, j = 0; i <= count; ++i) {
+		if (i == index) {
+			values[i].integer = 0;
+		} else {
+			values[i] = getValueAt(j++);
 		}
 	}
-	return nullptr;
+	setValues(values, count + 1);
+
+	attributeBits |= type;
+	return getValueAt(index);
 }
 
-ItemAttributes::Attribute& ItemAttributes::getAttr(itemAttrTypes type)
+void Item::setDuration(int32_t time)
 {
-	if (hasAttribute(type)) {
-		for (Attribute& attribute : attributes) {
-			if (attribute.type == type) {
-				return attribute;
-			}
-		}
+	if (getDecaying() != DECAYING_TRUE) {
+		getAttributes()->setIntAttr(ITEM_ATTRIBUTE_DURATION, time);
+		return;
 	}
 
-	attributeBits |= type;
-	attributes.emplace_front(type);
-	return attributes.front();
+	g_game.stopDecay(this);
+	getAttributes()->setIntAttr(ITEM_ATTRIBUTE_DURATION, time);
+	g_game.startDecay(this);
+}
+
+uint32_t Item::getDuration() const
+{
+	if (!attributes) {
+		return 0;
+	}
+
+	int64_t duration = attributes->getIntAttr(ITEM_ATTRIBUTE_DURATION);
+	if (getDecaying() == DECAYING_TRUE) {
+		duration = std::max<int64_t>(0, duration - OTSYS_TIME());
+	}
+	return static_cast<uint32_t>(duration);
+}
+
+void Item::setDecaying(ItemDecayState_t decayState)
+{
+	ItemDecayState_t oldState = getDecaying();
+	if (hasAttribute(ITEM_ATTRIBUTE_DURATION) && (oldState == DECAYING_TRUE) != (decayState == DECAYING_TRUE)) {
+		int64_t duration = attributes->getIntAttr(ITEM_ATTRIBUTE_DURATION);
+		if (decayState == DECAYING_TRUE) {
+			duration += OTSYS_TIME();
+		} else {
+			duration = std::max<int64_t>(0, duration - OTSYS_TIME());
+		}
+		attributes->setIntAttr(ITEM_ATTRIBUTE_DURATION, duration);
+	}
+	getAttributes()->setIntAttr(ITEM_ATTRIBUTE_DECAYSTATE, decayState);
 }
 
 void Item::startDecaying()
@@ -1640,15 +1748,15 @@ bool Item::hasMarketAttributes() const
 		return true;
 	}
 
-	for (const auto& attr : attributes->getList()) {
-		if (attr.type == ITEM_ATTRIBUTE_CHARGES) {
-			uint16_t charges = static_cast<uint16_t>(attr.value.integer);
+	for (uint32_t bits = attributes->attributeBits; bits != 0; bits &= bits - 1) {
+		itemAttrTypes type = static_cast<itemAttrTypes>(bits & (~bits + 1));
+		if (type == ITEM_ATTRIBUTE_CHARGES) {
+			uint16_t charges = static_cast<uint16_t>(attributes->getIntAttr(type));
 			if (charges != items[id].charges) {
 				return false;
 			}
-		} else if (attr.type == ITEM_ATTRIBUTE_DURATION) {
-			uint32_t duration = static_cast<uint32_t>(attr.value.integer);
-			if (duration != getDefaultDuration()) {
+		} else if (type == ITEM_ATTRIBUTE_DURATION) {
+			if (getDuration() != getDefaultDuration()) {
 				return false;
 			}
 		} else {
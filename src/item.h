@@ -24,6 +24,7 @@
 #include "thing.h"
 #include "items.h"
 
+#include <bitset>
 #include <deque>
 
 class Creature;
@@ -108,7 +109,14 @@ enum Attr_ReadValue {
 class ItemAttributes
 {
 	public:
-		ItemAttributes() : attributeBits(0) {}
+		ItemAttributes() : otherValues(nullptr), attributeBits(0) {
+			firstValue.integer = 0;
+		}
+		ItemAttributes(const ItemAttributes& other);
+		~ItemAttributes();
+
+		// non-assignable
+		ItemAttributes& operator=(const ItemAttributes&) = delete;
 
 		void setSpecialDescription(const std::string& desc) {
 			setStrAttr(ITEM_ATTRIBUTE_DESCRIPTION, desc);
@@ -192,9 +200,6 @@ class ItemAttributes
 		void setDuration(int32_t time) {
 			setIntAttr(ITEM_ATTRIBUTE_DURATION, time);
 		}
-		void decreaseDuration(int32_t time) {
-			increaseIntAttr(ITEM_ATTRIBUTE_DURATION, -time);
-		}
 		uint32_t getDuration() const {
 			return getIntAttr(ITEM_ATTRIBUTE_DURATION);
 		}
@@ -214,64 +219,32 @@ class ItemAttributes
 
 		static std::string emptyString;
 
-		struct Attribute
-		{
-			union {
-				int64_t integer;
-				std::string* string;
-			} value;
-			itemAttrTypes type;
-
-			explicit Attribute(itemAttrTypes type) : type(type) {
-				memset(&value, 0, sizeof(value));
-			}
-			Attribute(const Attribute& i) {
-				type = i.type;
-				if (ItemAttributes::isIntAttrType(type)) {
-					value.integer = i.value.integer;
-				} else if (ItemAttributes::isStrAttrType(type)) {
-					value.string = new std::string(*i.value.string);
-				} else {
-					memset(&value, 0, sizeof(value));
-				}
-			}
-			Attribute(Attribute&& attribute) : value(attribute.value), type(attribute.type) {
-				memset(&attribute.value, 0, sizeof(value));
-				attribute.type = ITEM_ATTRIBUTE_NONE;
-			}
-			~Attribute() {
-				if (ItemAttributes::isStrAttrType(type)) {
-					delete value.string;
-				}
-			}
-			Attribute& operator=(Attribute other) {
-				Attribute::swap(*this, other);
-				return *this;
-			}
-			Attribute& operator=(Attribute&& other) {
-				if (this != &other) {
-					if (ItemAttributes::isStrAttrType(type)) {
-						delete value.string;
-					}
-
-					value = other.value;
-					type = other.type;
-
-					memset(&other.value, 0, sizeof(value));
-					other.type = ITEM_ATTRIBUTE_NONE;
-				}
-				return *this;
-			}
-
-			static void swap(Attribute& first, Attribute& second) {
-				std::swap(first.value, second.value);
-				std::swap(first.type, second.type);
-			}
+		union Value {
+			int64_t integer;
+			std::string* string;
 		};
 
-		std::forward_list<Attribute> attributes;
+		// one value per bit set in attributeBits, in bit order, so the
+		// position of an attribute is the number of lower bits set; most
+		// items have a single attribute, which is kept inline
+		Value firstValue;
+		Value* otherValues;
 		uint32_t attributeBits;
 
+		size_t getIndex(itemAttrTypes type) const {
+			return std::bitset<32>(attributeBits & (type - 1)).count();
+		}
+		size_t getCount() const {
+			return std::bitset<32>(attributeBits).count();
+		}
+		Value& getValueAt(size_t index) {
+			return index == 0 ? firstValue : otherValues[index - 1];
+		}
+		const Value& getValueAt(size_t index) const {
+			return index == 0 ? firstValue : otherValues[index - 1];
+		}
+		void setValues(const Value* values, size_t count);
+
 		const std::string& getStrAttr(itemAttrTypes type) const;
 		void setStrAttr(itemAttrTypes type, const std::string& value);
 
@@ -279,9 +252,7 @@ class ItemAttributes
 		void setIntAttr(itemAttrTypes type, int64_t value);
 		void increaseIntAttr(itemAttrTypes type, int64_t value);
 
-		void addAttr(Attribute* attr);
-		const Attribute* getExistingAttr(itemAttrTypes type) const;
-		Attribute& getAttr(itemAttrTypes type);
+		Value& getValue(itemAttrTypes type);
 
 	public:
 		inline static bool isIntAttrType(itemAttrTypes type) {
@@ -291,13 +262,22 @@ class ItemAttributes
 			return (type & 0x1EC) != 0;
 		}
 
-		const std::forward_list<Attribute>& getList() const {
-			return attributes;
-		}
-
 	friend class Item;
 };
 
+// The map holds millions of items, most of them plain decoration, so items
+// are carved out of large chunks instead of paying the allocator overhead
+// for every single one of them.
+class ItemAllocator
+{
+	public:
+		static void* allocate(size_t size);
+		static void deallocate(void* p, size_t size);
+
+		static size_t getAllocatedBytes();
+		static size_t getUsedBytes();
+};
+
 class Item : virtual public Thing
 {
 	public:
@@ -307,6 +287,10 @@ class Item : virtual public Thing
 		static Item* CreateItem(PropStream& propStream);
 		static Items items;
 
+		// set while the map is decoded on several threads, unique ids and bed
+		// sleepers are then only stored on the items and registered later
+		static bool deferRegistration;
+
 		// Constructor for items
 		Item(const uint16_t _type, uint16_t _count = 0);
 		Item(const Item& i);
@@ -317,6 +301,13 @@ class Item : virtual public Thing
 		// non-assignable
 		Item& operator=(const Item&) = delete;
 
+		static void* operator new(size_t size) {
+			return ItemAllocator::allocate(size);
+		}
+		static void operator delete(void* p, size_t size) {
+			ItemAllocator::deallocate(p, size);
+		}
+
 		bool equals(const Item* otherItem) const;
 
 		Item* getItem() final {
@@ -376,10 +367,19 @@ class Item : virtual public Thing
 			if (!attributes) {
 				return 0;
 			}
+			if (type == ITEM_ATTRIBUTE_DURATION) {
+				return getDuration();
+			}
 			return attributes->getIntAttr(type);
 		}
 		void setIntAttr(itemAttrTypes type, int32_t value) {
-			getAttributes()->setIntAttr(type, value);
+			if (type == ITEM_ATTRIBUTE_DURATION) {
+				setDuration(value);
+			} else if (type == ITEM_ATTRIBUTE_DECAYSTATE) {
+				setDecaying(static_cast<ItemDecayState_t>(value));
+			} else {
+				getAttributes()->setIntAttr(type, value);
+			}
 		}
 		void increaseIntAttr(itemAttrTypes type, int32_t value) {
 			getAttributes()->increaseIntAttr(type, value);
@@ -495,22 +495,18 @@ class Item : virtual public Thing
 			return getIntAttr(ITEM_ATTRIBUTE_CORPSEOWNER);
 		}
 
-		void setDuration(int32_t time) {
-			setIntAttr(ITEM_ATTRIBUTE_DURATION, time);
-		}
-		void decreaseDuration(int32_t time) {
-			increaseIntAttr(ITEM_ATTRIBUTE_DURATION, -time);
-		}
-		uint32_t getDuration() const {
+		// while an item is decaying its duration attribute holds the time it
+		// expires at, the remaining duration is worked out when it is read
+		void setDuration(int32_t time);
+		uint32_t getDuration() const;
+		int64_t getDecayExpiry() const {
 			if (!attributes) {
 				return 0;
 			}
-			return getIntAttr(ITEM_ATTRIBUTE_DURATION);
+			return attributes->getIntAttr(ITEM_ATTRIBUTE_DURATION);
 		}
 
-		void setDecaying(ItemDecayState_t decayState) {
-			setIntAttr(ITEM_ATTRIBUTE_DECAYSTATE, decayState);
-		}
+		void setDecaying(ItemDecayState_t decayState);
 		ItemDecayState_t getDecaying() const {
 			if (!attributes) {
 				return DECAYING_FALSE;
@@ -123,6 +123,8 @@ Items::~Items()
 void Items::clear()
 {
 	items.clear();
+	clientIdToServerId.clear();
+	nameToServerId.clear();
 }
 
 bool Items::reload()
@@ -308,7 +310,12 @@ FILELOADER_ERRORS Items::loadFromOtb(const std::string& file)
 			}
 		}
 
-		reverseItemMap.emplace(clientId, serverId);
+		if (clientId >= clientIdToServerId.size()) {
+			clientIdToServerId.resize(clientId + 1);
+		}
+		if (clientIdToServerId[clientId] == 0) {
+			clientIdToServerId[clientId] = serverId;
+		}
 
 		// store the found item
 		if (serverId >= items.size()) {
@@ -414,9 +421,32 @@ bool Items::loadFromXml()
 			parseItemNode(itemNode, id++);
 		}
 	}
+
+	buildNameIndex();
 	return true;
 }
 
+void Items::buildNameIndex()
+{
+	nameToServerId.clear();
+
+	// names take precedence over plural names and the lowest id wins, as
+	// it did when the item list was searched in order
+	for (size_t i = 100, size = items.size(); i < size; ++i) {
+		const std::string& name = items[i].name;
+		if (!name.empty()) {
+			nameToServerId.emplace(asLowerCaseString(name), i);
+		}
+	}
+
+	for (size_t i = 100, size = items.size(); i < size; ++i) {
+		const std::string& pluralName = items[i].pluralName;
+		if (!pluralName.empty()) {
+			nameToServerId.emplace(asLowerCaseString(pluralName), i);
+		}
+	}
+}
+
 void Items::parseItemNode(const pugi::xml_node& itemNode, uint16_t id)
 {
 	if (id > 30000 && id < 30100) {
@@ -981,24 +1011,24 @@ const ItemType& Items::getItemType(size_t id) const
 
 const ItemType& Items::getItemIdByClientId(uint16_t spriteId) const
 {
-	auto it = reverseItemMap.find(spriteId);
-	if (it != reverseItemMap.end()) {
-		return getItemType(it->second);
+	if (spriteId < clientIdToServerId.size()) {
+		uint16_t serverId = clientIdToServerId[spriteId];
+		if (serverId != 0) {
+			return getItemType(serverId);
+		}
 	}
 	return items.front();
 }
 
-uint16_t Items::getItemIdByName(const std::string& name)
+uint16_t Items::getItemIdByName(const std::string& name) const
 {
 	if (name.empty()) {
 		return 0;
 	}
 
-	const char* itemName = name.c_str();
-	for (size_t i = 100, size = items.size(); i < size; ++i) {
-		if (strcasecmp(itemName, items[i].name.c_str()) == 0) {
-			return i;
-		}
+	auto it = nameToServerId.find(asLowerCaseString(name));
+	if (it == nameToServerId.end()) {
+		return 0;
 	}
-	return 0;
+	return it->second;
 }
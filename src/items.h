@@ -301,7 +301,7 @@ class Items
 		ItemType& getItemType(size_t id);
 		const ItemType& getItemIdByClientId(uint16_t spriteId) const;
 
-		uint16_t getItemIdByName(const std::string& name);
+		uint16_t getItemIdByName(const std::string& name) const;
 
 		static uint32_t dwMajorVersion;
 		static uint32_t dwMinorVersion;
@@ -315,7 +315,12 @@ class Items
 		}
 
 	protected:
-		std::map<uint16_t, uint16_t> reverseItemMap;
+		void buildNameIndex();
+
+		// server id by client id, 0 for client ids without an item
+		std::vector<uint16_t> clientIdToServerId;
+		// server id by lower case name or plural name
+		std::unordered_map<std::string, uint16_t> nameToServerId;
 		std::vector<ItemType> items;
 };
 #endif
@@ -6378,6 +6378,9 @@ int LuaScriptInterface::luaItemSetActionId(lua_State* L)
 	Item* item = getUserdata<Item>(L, 1);
 	if (item) {
 		item->setActionId(actionId);
+		if (Tile* tile = item->getTile()) {
+			tile->setHouseItemsChanged();
+		}
 		pushBoolean(L, true);
 	} else {
 		lua_pushnil(L);
@@ -6594,6 +6597,11 @@ int LuaScriptInterface::luaItemSetAttribute(lua_State* L)
 		pushBoolean(L, true);
 	} else {
 		lua_pushnil(L);
+		return 1;
+	}
+
+	if (Tile* tile = item->getTile()) {
+		tile->setHouseItemsChanged();
 	}
 	return 1;
 }
@@ -6619,6 +6627,9 @@ int LuaScriptInterface::luaItemRemoveAttribute(lua_State* L)
 	bool ret = attribute != ITEM_ATTRIBUTE_UNIQUEID;
 	if (ret) {
 		item->removeAttribute(attribute);
+		if (Tile* tile = item->getTile()) {
+			tile->setHouseItemsChanged();
+		}
 	} else {
 		reportErrorFunc("Attempt to erase protected key \"uid\"");
 	}
@@ -9832,6 +9843,7 @@ int LuaScriptInterface::luaMonsterGetFriendList(lua_State* L)
 		return 1;
 	}
 
+	monster->updateFriendList();
 	const auto& friendList = monster->getFriendList();
 	lua_createtable(L, friendList.size(), 0);
 
@@ -9849,6 +9861,7 @@ int LuaScriptInterface::luaMonsterGetFriendCount(lua_State* L)
 	// monster:getFriendCount()
 	Monster* monster = getUserdata<Monster>(L, 1);
 	if (monster) {
+		monster->updateFriendList();
 		lua_pushnumber(L, monster->getFriendList().size());
 	} else {
 		lua_pushnil(L);
@@ -27,8 +27,10 @@
 #include "combat.h"
 #include "creature.h"
 #include "game.h"
+#include "scheduler.h"
 
 extern Game g_game;
+extern Scheduler g_scheduler;
 
 bool Map::loadMap(const std::string& identifier, bool loadHouses)
 {
@@ -77,18 +79,22 @@ bool Map::save()
 	return saved;
 }
 
-Tile* Map::getTile(uint16_t x, uint16_t y, uint8_t z) const
+const Floor* Map::getFloor(uint16_t x, uint16_t y, uint8_t z) const
 {
 	if (z >= MAP_MAX_LAYERS) {
 		return nullptr;
 	}
 
-	const QTreeLeafNode* leaf = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, x, y);
+	const QTreeLeafNode* leaf = getLeaf(x, y);
 	if (!leaf) {
 		return nullptr;
 	}
+	return leaf->getFloor(z);
+}
 
-	const Floor* floor = leaf->getFloor(z);
+Tile* Map::getTile(uint16_t x, uint16_t y, uint8_t z) const
+{
+	const Floor* floor = getFloor(x, y, z);
 	if (!floor) {
 		return nullptr;
 	}
@@ -106,26 +112,32 @@ void Map::setTile(uint16_t x, uint16_t y, uint8_t z, Tile* newTile)
 	QTreeLeafNode* leaf = root.createLeaf(x, y, 15);
 
 	if (QTreeLeafNode::newLeaf) {
+		std::unique_ptr<LeafChunk>& chunk = leafIndex[(x >> LEAF_CHUNK_SHIFT) * LEAF_CHUNK_COUNT + (y >> LEAF_CHUNK_SHIFT)];
+		if (!chunk) {
+			chunk.reset(new LeafChunk);
+		}
+		chunk->leafs[(x >> FLOOR_BITS) & LEAF_CHUNK_MASK][(y >> FLOOR_BITS) & LEAF_CHUNK_MASK] = leaf;
+
 		//update north
-		QTreeLeafNode* northLeaf = root.getLeaf(x, y - FLOOR_SIZE);
+		QTreeLeafNode* northLeaf = getLeaf(x, y - FLOOR_SIZE);
 		if (northLeaf) {
 			northLeaf->m_leafS = leaf;
 		}
 
 		//update west leaf
-		QTreeLeafNode* westLeaf = root.getLeaf(x - FLOOR_SIZE, y);
+		QTreeLeafNode* westLeaf = getLeaf(x - FLOOR_SIZE, y);
 		if (westLeaf) {
 			westLeaf->m_leafE = leaf;
 		}
 
 		//update south
-		QTreeLeafNode* southLeaf = root.getLeaf(x, y + FLOOR_SIZE);
+		QTreeLeafNode* southLeaf = getLeaf(x, y + FLOOR_SIZE);
 		if (southLeaf) {
 			leaf->m_leafS = southLeaf;
 		}
 
 		//update east
-		QTreeLeafNode* eastLeaf = root.getLeaf(x + FLOOR_SIZE, y);
+		QTreeLeafNode* eastLeaf = getLeaf(x + FLOOR_SIZE, y);
 		if (eastLeaf) {
 			leaf->m_leafE = eastLeaf;
 		}
@@ -153,6 +165,7 @@ void Map::setTile(uint16_t x, uint16_t y, uint8_t z, Tile* newTile)
 	} else {
 		tile = newTile;
 		tile->qt_node = leaf;
+		tile->updateBlockMasks();
 	}
 }
 
@@ -198,7 +211,12 @@ bool Map::placeCreature(const Position& centerPos, Creature* creature, bool exte
 		for (const auto& it : relList) {
 			Position tryPos(centerPos.x + it.first, centerPos.y + it.second, centerPos.z);
 
-			tile = getTile(tryPos.x, tryPos.y, tryPos.z);
+			const Floor* floor = getFloor(tryPos.x, tryPos.y, tryPos.z);
+			if (!floor || (floor->blockSolid & Floor::getMaskBit(tryPos.x, tryPos.y)) != 0) {
+				continue;
+			}
+
+			tile = floor->tiles[tryPos.x & FLOOR_MASK][tryPos.y & FLOOR_MASK];
 			if (!tile || (placeInPZ && !tile->hasFlag(TILESTATE_PROTECTIONZONE))) {
 				continue;
 			}
@@ -224,7 +242,7 @@ bool Map::placeCreature(const Position& centerPos, Creature* creature, bool exte
 	toCylinder->internalAddThing(creature);
 
 	Tile* toTile = toCylinder->getTile();
-	toTile->qt_node->addCreature(creature);
+	toTile->qt_node->addCreature(creature, toTile->getPosition().z);
 	return true;
 }
 
@@ -255,13 +273,13 @@ void Map::moveCreature(Creature& creature, Tile& newTile, bool forceTeleport/* =
 	//remove the creature
 	oldTile.removeThing(&creature, 0);
 
-	QTreeLeafNode* leaf = QTreeNode::getLeafStatic<QTreeLeafNode*, QTreeNode*>(&root, oldPos.x, oldPos.y);
-	QTreeLeafNode* new_leaf = QTreeNode::getLeafStatic<QTreeLeafNode*, QTreeNode*>(&root, newPos.x, newPos.y);
+	QTreeLeafNode* leaf = getLeaf(oldPos.x, oldPos.y);
+	QTreeLeafNode* new_leaf = getLeaf(newPos.x, newPos.y);
 
 	// Switch the node ownership
-	if (leaf != new_leaf) {
-		leaf->removeCreature(&creature);
-		new_leaf->addCreature(&creature);
+	if (leaf != new_leaf || oldPos.z != newPos.z) {
+		leaf->removeCreature(&creature, oldPos.z);
+		new_leaf->addCreature(&creature, newPos.z);
 	}
 
 	//add the creature
@@ -302,7 +320,7 @@ void Map::moveCreature(Creature& creature, Tile& newTile, bool forceTeleport/* =
 	newTile.postAddNotification(&creature, &oldTile, 0);
 }
 
-void Map::getSpectatorsInternal(SpectatorVec& list, const Position& centerPos, int32_t minRangeX, int32_t maxRangeX, int32_t minRangeY, int32_t maxRangeY, int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers) const
+void Map::getSpectatorsInternal(SpectatorVec& list, const Position& centerPos, int32_t minRangeX, int32_t maxRangeX, int32_t minRangeY, int32_t maxRangeY, int32_t minRangeZ, int32_t maxRangeZ, CreatureVector Floor::* floorList) const
 {
 	int_fast16_t min_y = centerPos.y + minRangeY;
 	int_fast16_t min_x = centerPos.x + minRangeX;
@@ -322,7 +340,9 @@ void Map::getSpectatorsInternal(SpectatorVec& list, const Position& centerPos, i
 	int32_t endx2 = x2 - (x2 % FLOOR_SIZE);
 	int32_t endy2 = y2 - (y2 % FLOOR_SIZE);
 
-	const QTreeLeafNode* startLeaf = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, startx1, starty1);
+	const uint32_t floorRange = ((1 << (maxRangeZ + 1)) - 1) & ~((1 << minRangeZ) - 1);
+
+	const QTreeLeafNode* startLeaf = getLeaf(startx1, starty1);
 	const QTreeLeafNode* leafS = startLeaf;
 	const QTreeLeafNode* leafE;
 
@@ -330,40 +350,53 @@ void Map::getSpectatorsInternal(SpectatorVec& list, const Position& centerPos, i
 		leafE = leafS;
 		for (int_fast32_t nx = startx1; nx <= endx2; nx += FLOOR_SIZE) {
 			if (leafE) {
-				const CreatureVector& node_list = (onlyPlayers ? leafE->player_list : leafE->creature_list);
-				CreatureVector::const_iterator node_iter = node_list.begin();
-				CreatureVector::const_iterator node_end = node_list.end();
-				if (node_iter != node_end) {
-					do {
-						Creature* creature = *node_iter;
+				// most floors of a block have nobody on them, their Floor is not even loaded
+				const uint32_t floors = leafE->creatureFloors & floorRange;
+				for (int32_t nz = minRangeZ; floors != 0 && nz <= maxRangeZ; ++nz) {
+					if ((floors & (1 << nz)) == 0) {
+						continue;
+					}
 
-						const Position& cpos = creature->getPosition();
-						if (cpos.z < minRangeZ || cpos.z > maxRangeZ) {
-							continue;
-						}
+					// the visible area is shifted by one tile per floor of difference
+					int_fast32_t offsetZ = centerPos.getZ() - nz;
+					int_fast32_t floorMinX = min_x + offsetZ;
+					int_fast32_t floorMaxX = max_x + offsetZ;
+					int_fast32_t floorMinY = min_y + offsetZ;
+					int_fast32_t floorMaxY = max_y + offsetZ;
+					if (nx > floorMaxX || nx + FLOOR_MASK < floorMinX || ny > floorMaxY || ny + FLOOR_MASK < floorMinY) {
+						continue;
+					}
 
-						int_fast16_t offsetZ = Position::getOffsetZ(centerPos, cpos);
-						if (cpos.y < (min_y + offsetZ) || cpos.y > (max_y + offsetZ)) {
-							continue;
-						}
+					const CreatureVector& floor_list = leafE->getFloor(nz)->*floorList;
+					if (floor_list.empty()) {
+						continue;
+					}
 
-						if (cpos.x < (min_x + offsetZ) || cpos.x > (max_x + offsetZ)) {
-							continue;
+					if (nx >= floorMinX && nx + FLOOR_MASK <= floorMaxX && ny >= floorMinY && ny + FLOOR_MASK <= floorMaxY) {
+						// the whole block is in range
+						for (Creature* creature : floor_list) {
+							list.emplace_back(creature);
 						}
+						continue;
+					}
 
-						list.insert(creature);
-					} while (++node_iter != node_end);
+					for (Creature* creature : floor_list) {
+						const Position& cpos = creature->getPosition();
+						if (cpos.x >= floorMinX && cpos.x <= floorMaxX && cpos.y >= floorMinY && cpos.y <= floorMaxY) {
+							list.emplace_back(creature);
+						}
+					}
 				}
 				leafE = leafE->m_leafE;
 			} else {
-				leafE = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, nx + FLOOR_SIZE, ny);
+				leafE = getLeaf(nx + FLOOR_SIZE, ny);
 			}
 		}
 
 		if (leafS) {
 			leafS = leafS->m_leafS;
 		} else {
-			leafS = QTreeNode::getLeafStatic<const QTreeLeafNode*, const QTreeNode*>(&root, startx1, ny + FLOOR_SIZE);
+			leafS = getLeaf(startx1, ny + FLOOR_SIZE);
 		}
 	}
 }
@@ -386,13 +419,7 @@ void Map::getSpectators(SpectatorVec& list, const Position& centerPos, bool mult
 		if (onlyPlayers) {
 			auto it = playersSpectatorCache.find(centerPos);
 			if (it != playersSpectatorCache.end()) {
-				if (!list.empty()) {
-					const SpectatorVec& cachedList = *it->second;
-					list.insert(cachedList.begin(), cachedList.end());
-				} else {
-					list = *it->second;
-				}
-
+				list.addSpectators(*it->second);
 				foundCache = true;
 			}
 		}
@@ -401,17 +428,16 @@ void Map::getSpectators(SpectatorVec& list, const Position& centerPos, bool mult
 			auto it = spectatorCache.find(centerPos);
 			if (it != spectatorCache.end()) {
 				if (!onlyPlayers) {
-					if (!list.empty()) {
-						const SpectatorVec& cachedList = *it->second;
-						list.insert(cachedList.begin(), cachedList.end());
-					} else {
-						list = *it->second;
-					}
+					list.addSpectators(*it->second);
 				} else {
-					const SpectatorVec& cachedList = *it->second;
-					for (Creature* spectator : cachedList) {
+					const bool checkDuplicate = !list.empty();
+					for (Creature* spectator : *it->second) {
 						if (spectator->getPlayer()) {
-							list.insert(spectator);
+							if (checkDuplicate) {
+								list.insert(spectator);
+							} else {
+								list.emplace_back(spectator);
+							}
 						}
 					}
 				}
@@ -428,39 +454,69 @@ void Map::getSpectators(SpectatorVec& list, const Position& centerPos, bool mult
 		int32_t maxRangeZ;
 
 		if (multifloor) {
-			if (centerPos.z > 7) {
-				//underground
-
-				//8->15
-				minRangeZ = std::max<int32_t>(centerPos.getZ() - 2, 0);
-				maxRangeZ = std::min<int32_t>(centerPos.getZ() + 2, MAP_MAX_LAYERS - 1);
-			} else if (centerPos.z == 6) {
-				minRangeZ = 0;
-				maxRangeZ = 8;
-			} else if (centerPos.z == 7) {
-				minRangeZ = 0;
-				maxRangeZ = 9;
-			} else {
-				minRangeZ = 0;
-				maxRangeZ = 7;
-			}
+			getSpectatorFloors(centerPos, minRangeZ, maxRangeZ);
 		} else {
 			minRangeZ = centerPos.z;
 			maxRangeZ = centerPos.z;
 		}
 
-		getSpectatorsInternal(list, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers);
+		// a single scan never yields duplicates, so only merge into a non-empty list
+		SpectatorVec spectators;
+		SpectatorVec& result = (list.empty() ? list : spectators);
+		getSpectatorsInternal(result, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers ? &Floor::players : &Floor::creatures);
+		if (&result != &list) {
+			list.addSpectators(result);
+		}
 
 		if (cacheResult) {
 			if (onlyPlayers) {
-				playersSpectatorCache[centerPos].reset(new SpectatorVec(list));
+				playersSpectatorCache[centerPos].reset(new SpectatorVec(result));
 			} else {
-				spectatorCache[centerPos].reset(new SpectatorVec(list));
+				spectatorCache[centerPos].reset(new SpectatorVec(result));
 			}
 		}
 	}
 }
 
+void Map::getSpectatorFloors(const Position& centerPos, int32_t& minRangeZ, int32_t& maxRangeZ)
+{
+	if (centerPos.z > 7) {
+		//underground
+
+		//8->15
+		minRangeZ = std::max<int32_t>(centerPos.getZ() - 2, 0);
+		maxRangeZ = std::min<int32_t>(centerPos.getZ() + 2, MAP_MAX_LAYERS - 1);
+	} else if (centerPos.z == 6) {
+		minRangeZ = 0;
+		maxRangeZ = 8;
+	} else if (centerPos.z == 7) {
+		minRangeZ = 0;
+		maxRangeZ = 9;
+	} else {
+		minRangeZ = 0;
+		maxRangeZ = 7;
+	}
+}
+
+void Map::getTargetCandidates(SpectatorVec& list, const Position& centerPos) const
+{
+	if (centerPos.z >= MAP_MAX_LAYERS) {
+		return;
+	}
+
+	int32_t minRangeZ;
+	int32_t maxRangeZ;
+	getSpectatorFloors(centerPos, minRangeZ, maxRangeZ);
+
+	// a single scan never yields duplicates, so only merge into a non-empty list
+	SpectatorVec candidates;
+	SpectatorVec& result = (list.empty() ? list : candidates);
+	getSpectatorsInternal(result, centerPos, -maxViewportX, maxViewportX, -maxViewportY, maxViewportY, minRangeZ, maxRangeZ, &Floor::targetCandidates);
+	if (&result != &list) {
+		list.addSpectators(result);
+	}
+}
+
 void Map::clearSpectatorCache()
 {
 	spectatorCache.clear();
@@ -513,6 +569,11 @@ bool Map::checkSightLine(const Position& fromPos, const Position& toPos) const
 	int32_t B = Position::getOffsetX(start, destination);
 	int32_t C = -(A * destination.x + B * destination.y);
 
+	// lines mostly stay inside one 8x8 block, so the block is only looked up
+	// again when the line leaves it
+	const Floor* floor = nullptr;
+	uint32_t floorIndex = std::numeric_limits<uint32_t>::max();
+
 	while (start.x != destination.x || start.y != destination.y) {
 		int32_t move_hor = std::abs(A * (start.x + mx) + B * (start.y) + C);
 		int32_t move_ver = std::abs(A * (start.x) + B * (start.y + my) + C);
@@ -526,8 +587,19 @@ bool Map::checkSightLine(const Position& fromPos, const Position& toPos) const
 			start.x += mx;
 		}
 
+		const uint32_t index = (static_cast<uint32_t>(start.x >> FLOOR_BITS) << 16) | (start.y >> FLOOR_BITS);
+		if (index != floorIndex) {
+			floor = getFloor(start.x, start.y, start.z);
+			floorIndex = index;
+		}
+
+		const bool blocked = floor && (floor->blockProjectile & Floor::getMaskBit(start.x, start.y)) != 0;
+#ifndef NDEBUG
+		// the mask has to agree with the item properties it mirrors
 		const Tile* tile = getTile(start.x, start.y, start.z);
-		if (tile && tile->hasProperty(CONST_PROP_BLOCKPROJECTILE)) {
+		assert(blocked == (tile && tile->hasProperty(CONST_PROP_BLOCKPROJECTILE)));
+#endif
+		if (blocked) {
 			return false;
 		}
 	}
@@ -565,9 +637,18 @@ const Tile* Map::canWalkTo(const Creature& creature, const Position& pos) const
 	}
 
 	//used for non-cached tiles
-	Tile* tile = getTile(pos.x, pos.y, pos.z);
+	const Floor* floor = getFloor(pos.x, pos.y, pos.z);
+	if (!floor) {
+		return nullptr;
+	}
+
+	Tile* tile = floor->tiles[pos.x & FLOOR_MASK][pos.y & FLOOR_MASK];
 	if (creature.getTile() != tile) {
-		if (!tile || tile->queryAdd(0, creature, 1, FLAG_PATHFINDING | FLAG_IGNOREFIELDDAMAGE) != RETURNVALUE_NOERROR) {
+		if (!tile || (floor->blockPath & Floor::getMaskBit(pos.x, pos.y)) != 0) {
+			return nullptr;
+		}
+
+		if (tile->queryAdd(0, creature, 1, FLAG_PATHFINDING | FLAG_IGNOREFIELDDAMAGE) != RETURNVALUE_NOERROR) {
 			return nullptr;
 		}
 	}
@@ -751,19 +832,27 @@ bool Map::getPathMatching(const Creature& creature, std::forward_list<Direction>
 
 // AStarNodes
 
+static inline size_t getNodeTableSlot(uint32_t x, uint32_t y)
+{
+	const uint32_t mask = (1 << NODE_TABLE_BITS) - 1;
+	return ((x & mask) << NODE_TABLE_BITS) | (y & mask);
+}
+
 AStarNodes::AStarNodes(uint32_t x, uint32_t y)
-	: openNodes()
+	: nodeTable()
 {
 	curNode = 1;
 	closedNodes = 0;
 	openNodes[0] = true;
+	openEntryCount = 0;
 
 	AStarNode& startNode = nodes[0];
 	startNode.parent = nullptr;
 	startNode.x = x;
 	startNode.y = y;
 	startNode.f = 0;
-	nodeTable[(x << 16) | y] = &startNode;
+	nodeTable[getNodeTableSlot(x, y)] = 1;
+	pushOpenEntry(0);
 }
 
 AStarNode* AStarNodes::createOpenNode(AStarNode* parent, uint32_t x, uint32_t y, int_fast32_t f)
@@ -776,31 +865,48 @@ AStarNode* AStarNodes::createOpenNode(AStarNode* parent, uint32_t x, uint32_t y,
 	openNodes[retNode] = true;
 
 	AStarNode* node = &nodes[retNode];
-	nodeTable[(x << 16) | y] = node;
 	node->parent = parent;
 	node->x = x;
 	node->y = y;
 	node->f = f;
+
+	size_t slot = getNodeTableSlot(x, y);
+	while (nodeTable[slot] != 0) {
+		slot = (slot + 1) & (NODE_TABLE_SIZE - 1);
+	}
+	nodeTable[slot] = retNode + 1;
+
+	pushOpenEntry(retNode);
 	return node;
 }
 
-AStarNode* AStarNodes::getBestNode()
+void AStarNodes::pushOpenEntry(size_t index)
 {
-	if (curNode == 0) {
-		return nullptr;
+	if (openEntryCount >= MAX_OPEN_ENTRIES) {
+		// drop the stale entries, every open node has exactly one valid entry
+		openEntryCount = 0;
+		for (size_t i = 0; i < curNode; ++i) {
+			if (openNodes[i] && i != index) {
+				openEntries[openEntryCount++] = {static_cast<int32_t>(nodes[i].f), static_cast<uint16_t>(i)};
+			}
+		}
+		std::make_heap(openEntries, openEntries + openEntryCount);
 	}
 
-	int32_t best_node_f = std::numeric_limits<int32_t>::max();
-	int32_t best_node = -1;
-	for (size_t i = 0; i < curNode; i++) {
-		if (openNodes[i] && nodes[i].f < best_node_f) {
-			best_node_f = nodes[i].f;
-			best_node = i;
+	openEntries[openEntryCount++] = {static_cast<int32_t>(nodes[index].f), static_cast<uint16_t>(index)};
+	std::push_heap(openEntries, openEntries + openEntryCount);
+}
+
+AStarNode* AStarNodes::getBestNode()
+{
+	while (openEntryCount != 0) {
+		const OpenEntry& entry = openEntries[0];
+		if (openNodes[entry.index] && nodes[entry.index].f == entry.f) {
+			return &nodes[entry.index];
 		}
-	}
 
-	if (best_node >= 0) {
-		return &nodes[best_node];
+		std::pop_heap(openEntries, openEntries + openEntryCount);
+		--openEntryCount;
 	}
 	return nullptr;
 }
@@ -829,6 +935,9 @@ void AStarNodes::openNode(AStarNode* node)
 		openNodes[pos] = true;
 		--closedNodes;
 	}
+
+	// the node either got reopened or cheaper, its older entries are stale now
+	pushOpenEntry(pos);
 }
 
 int_fast32_t AStarNodes::getClosedNodes() const
@@ -838,11 +947,15 @@ int_fast32_t AStarNodes::getClosedNodes() const
 
 AStarNode* AStarNodes::getNodeByPosition(uint32_t x, uint32_t y)
 {
-	auto it = nodeTable.find((x << 16) | y);
-	if (it == nodeTable.end()) {
-		return nullptr;
+	size_t slot = getNodeTableSlot(x, y);
+	while (uint16_t index = nodeTable[slot]) {
+		AStarNode* node = &nodes[index - 1];
+		if (node->x == x && node->y == y) {
+			return node;
+		}
+		slot = (slot + 1) & (NODE_TABLE_SIZE - 1);
 	}
-	return it->second;
+	return nullptr;
 }
 
 int_fast32_t AStarNodes::getMapWalkCost(AStarNode* node, const Position& neighborPos)
@@ -940,6 +1053,7 @@ QTreeLeafNode::QTreeLeafNode()
 	m_isLeaf = true;
 	m_leafS = nullptr;
 	m_leafE = nullptr;
+	creatureFloors = 0;
 }
 
 QTreeLeafNode::~QTreeLeafNode()
@@ -957,97 +1071,125 @@ Floor* QTreeLeafNode::createFloor(uint32_t z)
 	return m_array[z];
 }
 
-void QTreeLeafNode::addCreature(Creature* c)
+void QTreeLeafNode::addCreature(Creature* c, uint8_t z)
 {
-	creature_list.push_back(c);
+	Floor* floor = m_array[z];
+	assert(floor != nullptr);
+	floor->creatures.push_back(c);
+	c->mapFloor = floor;
+	creatureFloors |= 1 << z;
 
 	if (c->getPlayer()) {
-		player_list.push_back(c);
+		floor->players.push_back(c);
+	}
+
+	if (c->isMonsterTargetCandidate()) {
+		floor->targetCandidates.push_back(c);
+		c->targetCandidate = true;
 	}
 }
 
-void QTreeLeafNode::removeCreature(Creature* c)
+void QTreeLeafNode::removeCreature(Creature* c, uint8_t z)
 {
-	CreatureVector::iterator iter = std::find(creature_list.begin(), creature_list.end(), c);
-	assert(iter != creature_list.end());
-	*iter = creature_list.back();
-	creature_list.pop_back();
+	Floor* floor = m_array[z];
+	assert(floor != nullptr);
+
+	CreatureVector::iterator iter = std::find(floor->creatures.begin(), floor->creatures.end(), c);
+	assert(iter != floor->creatures.end());
+	*iter = floor->creatures.back();
+	floor->creatures.pop_back();
+	if (floor->creatures.empty()) {
+		creatureFloors &= ~(1 << z);
+	}
 
 	if (c->getPlayer()) {
-		iter = std::find(player_list.begin(), player_list.end(), c);
-		assert(iter != player_list.end());
-		*iter = player_list.back();
-		player_list.pop_back();
+		iter = std::find(floor->players.begin(), floor->players.end(), c);
+		assert(iter != floor->players.end());
+		*iter = floor->players.back();
+		floor->players.pop_back();
+	}
+
+	if (c->targetCandidate) {
+		iter = std::find(floor->targetCandidates.begin(), floor->targetCandidates.end(), c);
+		assert(iter != floor->targetCandidates.end());
+		*iter = floor->targetCandidates.back();
+		floor->targetCandidates.pop_back();
+		c->targetCandidate = false;
 	}
+	c->mapFloor = nullptr;
 }
 
-uint32_t Map::clean() const
+uint32_t Map::clean()
 {
-	uint64_t start = OTSYS_TIME();
-	size_t count = 0, tiles = 0;
+	const bool running = !cleanQueue.empty();
+	if (!running) {
+		cleanStartTime = OTSYS_TIME();
+		cleanLongestSlice = 0;
+		cleanItems = 0;
+		cleanTiles = 0;
+		cleanSlices = 0;
+	}
+
+	const size_t queued = cleanableTiles.size();
+	cleanQueue.insert(cleanQueue.end(), cleanableTiles.begin(), cleanableTiles.end());
+	cleanableTiles.clear();
 
-	if (g_game.getGameState() == GAME_STATE_NORMAL) {
-		g_game.setGameState(GAME_STATE_MAINTAIN);
+	if (!running && !cleanQueue.empty()) {
+		g_scheduler.addEvent(createSchedulerTask(EVENT_MAP_CLEAN_INTERVAL, std::bind(&Game::checkMapClean, &g_game)));
 	}
+	return queued;
+}
 
-	std::vector<const QTreeNode*> nodes {
-		&root
-	};
-	std::vector<Item*> toRemove;
-	do {
-		const QTreeNode* node = nodes.back();
-		nodes.pop_back();
-		if (node->isLeaf()) {
-			const QTreeLeafNode* leafNode = reinterpret_cast<const QTreeLeafNode*>(node);
-			for (uint16_t z = 0; z < MAP_MAX_LAYERS; ++z) {
-				Floor* floor = leafNode->getFloor(z);
-				if (!floor) {
-					continue;
-				}
+bool Map::cleanStep()
+{
+	auto sliceStart = std::chrono::steady_clock::now();
+	auto sliceEnd = sliceStart + std::chrono::milliseconds(MAP_CLEAN_SLICE_TIME);
 
-				for (size_t x = 0; x < FLOOR_SIZE; ++x) {
-					for (size_t y = 0; y < FLOOR_SIZE; ++y) {
-						Tile* tile = floor->tiles[x][y];
-						if (!tile || tile->hasFlag(TILESTATE_PROTECTIONZONE)) {
-							continue;
-						}
+	std::vector<Item*> toRemove;
+	size_t visited = 0;
+	while (!cleanQueue.empty()) {
+		// the clock is only read every few tiles, one tile is cheap
+		if ((++visited & 0x0F) == 0 && std::chrono::steady_clock::now() >= sliceEnd) {
+			break;
+		}
 
-						TileItemVector* itemList = tile->getItemList();
-						if (!itemList) {
-							continue;
-						}
+		Tile* tile = cleanQueue.back();
+		cleanQueue.pop_back();
+		if (tile->hasFlag(TILESTATE_PROTECTIONZONE)) {
+			continue;
+		}
 
-						++tiles;
-						for (Item* item : *itemList) {
-							if (item->isCleanable()) {
-								toRemove.push_back(item);
-							}
-						}
+		TileItemVector* itemList = tile->getItemList();
+		if (!itemList) {
+			continue;
+		}
 
-						for (Item* item : toRemove) {
-							g_game.internalRemoveItem(item, -1);
-						}
-						count += toRemove.size();
-						toRemove.clear();
-					}
-				}
-			}
-		} else {
-			for (size_t i = 0; i < 4; ++i) {
-				QTreeNode* childNode = node->m_child[i];
-				if (childNode) {
-					nodes.push_back(childNode);
-				}
+		++cleanTiles;
+		for (Item* item : *itemList) {
+			if (item->isCleanable()) {
+				toRemove.push_back(item);
 			}
 		}
-	} while (!nodes.empty());
 
-	if (g_game.getGameState() == GAME_STATE_MAINTAIN) {
-		g_game.setGameState(GAME_STATE_NORMAL);
+		for (Item* item : toRemove) {
+			g_game.internalRemoveItem(item, -1);
+		}
+		cleanItems += toRemove.size();
+		toRemove.clear();
+	}
+
+	int64_t sliceTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sliceStart).count();
+	cleanLongestSlice = std::max<int64_t>(cleanLongestSlice, sliceTime);
+	++cleanSlices;
+
+	if (!cleanQueue.empty()) {
+		return true;
 	}
 
-	std::cout << "> CLEAN: Removed " << count << " item" << (count != 1 ? "s" : "")
-	          << " from " << tiles << " tile" << (tiles != 1 ? "s" : "") << " in "
-	          << (OTSYS_TIME() - start) / (1000.) << " seconds." << std::endl;
-	return count;
+	std::cout << "> CLEAN: Removed " << cleanItems << " item" << (cleanItems != 1 ? "s" : "")
+	          << " from " << cleanTiles << " tile" << (cleanTiles != 1 ? "s" : "") << " in "
+	          << cleanSlices << " slice" << (cleanSlices != 1 ? "s" : "") << " over "
+	          << (OTSYS_TIME() - cleanStartTime) / (1000.) << " seconds, longest slice "
+	          << cleanLongestSlice / (1000.) << " ms." << std::endl;
+	return false;
 }
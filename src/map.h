@@ -21,6 +21,7 @@
 #define FS_MAP_H_E3953D57C058461F856F5221D359DAFA
 
 #include <bitset>
+#include <unordered_set>
 
 #include "position.h"
 #include "item.h"
@@ -40,6 +41,10 @@ class Map;
 
 #define MAP_MAX_LAYERS 16
 
+// map cleaning runs in slices of at most this many milliseconds, one slice per interval
+#define MAP_CLEAN_SLICE_TIME 10
+#define EVENT_MAP_CLEAN_INTERVAL 50
+
 struct FindPathParams;
 struct AStarNode {
 	AStarNode* parent;
@@ -50,6 +55,13 @@ struct AStarNode {
 #define MAX_NODES 512
 #define GET_NODE_INDEX(a) (a - &nodes[0])
 
+// open list entries, stale ones (closed nodes or nodes that got cheaper since) are skipped
+#define MAX_OPEN_ENTRIES 1024
+
+// nodes are looked up by their position inside a 32x32 window, with linear probing
+#define NODE_TABLE_BITS 5
+#define NODE_TABLE_SIZE (1 << (NODE_TABLE_BITS * 2))
+
 #define MAP_NORMALWALKCOST 10
 #define MAP_DIAGONALWALKCOST 25
 
@@ -69,9 +81,24 @@ class AStarNodes
 		static int_fast32_t getTileWalkCost(const Creature& creature, const Tile* tile);
 
 	private:
+		struct OpenEntry {
+			int32_t f;
+			uint16_t index;
+
+			// orders the open list as a min-heap by cost, ties go to the older node
+			bool operator<(const OpenEntry& other) const {
+				return f > other.f || (f == other.f && index > other.index);
+			}
+		};
+
+		void pushOpenEntry(size_t index);
+
 		AStarNode nodes[MAX_NODES];
 		bool openNodes[MAX_NODES];
-		std::unordered_map<uint32_t, AStarNode*> nodeTable;
+		OpenEntry openEntries[MAX_OPEN_ENTRIES];
+		// node index + 1, 0 marks an empty slot
+		uint16_t nodeTable[NODE_TABLE_SIZE];
+		size_t openEntryCount;
 		size_t curNode;
 		int_fast32_t closedNodes;
 };
@@ -83,7 +110,7 @@ typedef std::map<Position, std::shared_ptr<SpectatorVec>> SpectatorCache;
 #define FLOOR_MASK (FLOOR_SIZE - 1)
 
 struct Floor {
-	Floor() : tiles() {}
+	Floor() : tiles(), blockSolid(0), blockPath(0), blockProjectile(0) {}
 	~Floor();
 
 	// non-copyable
@@ -91,6 +118,21 @@ struct Floor {
 	Floor& operator=(const Floor&) = delete;
 
 	Tile* tiles[FLOOR_SIZE][FLOOR_SIZE];
+
+	// one bit per tile, kept up to date by Tile::updateBlockMasks so that
+	// tiles nobody can walk on are rejected without calling Tile::queryAdd
+	uint64_t blockSolid; // no creature can stand on the tile
+	uint64_t blockPath; // path search never enters the tile (also floor changes and teleports)
+	uint64_t blockProjectile; // line of sight stops at the tile
+
+	static uint64_t getMaskBit(uint32_t x, uint32_t y) {
+		return static_cast<uint64_t>(1) << (((x & FLOOR_MASK) << FLOOR_BITS) | (y & FLOOR_MASK));
+	}
+
+	// creatures standing on this floor of the block, used for spectator lookups
+	CreatureVector creatures;
+	CreatureVector players;
+	CreatureVector targetCandidates; // see Creature::isMonsterTargetCandidate
 };
 
 class FrozenPathingConditionCall;
@@ -152,21 +194,33 @@ class QTreeLeafNode final : public QTreeNode
 			return m_array[z];
 		}
 
-		void addCreature(Creature* c);
-		void removeCreature(Creature* c);
+		void addCreature(Creature* c, uint8_t z);
+		void removeCreature(Creature* c, uint8_t z);
 
 	protected:
 		static bool newLeaf;
 		QTreeLeafNode* m_leafS;
 		QTreeLeafNode* m_leafE;
 		Floor* m_array[MAP_MAX_LAYERS];
-		CreatureVector creature_list;
-		CreatureVector player_list;
+		uint16_t creatureFloors; // one bit per floor with creatures, spectator scans skip the others
 
 		friend class Map;
 		friend class QTreeNode;
 };
 
+#define LEAF_CHUNK_BITS 5
+#define LEAF_CHUNK_SIZE (1 << LEAF_CHUNK_BITS)
+#define LEAF_CHUNK_MASK (LEAF_CHUNK_SIZE - 1)
+#define LEAF_CHUNK_SHIFT (FLOOR_BITS + LEAF_CHUNK_BITS)
+#define LEAF_CHUNK_COUNT (0x10000 >> LEAF_CHUNK_SHIFT)
+
+// a square of leaves, allocated only where the map actually has tiles
+struct LeafChunk {
+	LeafChunk() : leafs() {}
+
+	QTreeLeafNode* leafs[LEAF_CHUNK_SIZE][LEAF_CHUNK_SIZE];
+};
+
 /**
   * Map class.
   * Holds all the actual map-data
@@ -175,14 +229,29 @@ class QTreeLeafNode final : public QTreeNode
 class Map
 {
 	public:
-		Map() : width(0), height(0) {}
+		Map() : cleanStartTime(0), cleanLongestSlice(0), cleanItems(0), cleanTiles(0), cleanSlices(0), width(0), height(0) {}
 
 		static const int32_t maxViewportX = 11; //min value: maxClientViewportX + 1
 		static const int32_t maxViewportY = 11; //min value: maxClientViewportY + 1
 		static const int32_t maxClientViewportX = 8;
 		static const int32_t maxClientViewportY = 6;
 
-		uint32_t clean() const;
+		/**
+		  * Queue the tiles that received cleanable items since the last clean.
+		  * Their items are removed over the next dispatcher frames by cleanStep.
+		  * \returns The number of tiles queued
+		  */
+		uint32_t clean();
+
+		/**
+		  * Clean queued tiles until the time slice is used up.
+		  * \returns true if there are tiles left for another slice
+		  */
+		bool cleanStep();
+
+		void addCleanableTile(Tile* tile) {
+			cleanableTiles.insert(tile);
+		}
 
 		/**
 		  * Load a map.
@@ -235,6 +304,14 @@ class Map
 		                   int32_t minRangeY = 0, int32_t maxRangeY = 0);
 
 		void clearSpectatorCache();
+
+		/**
+		  * Gets the players and player summons in view of a position, the
+		  * creatures a monster can pick targets from
+		  * \param list the list the creatures are added to
+		  * \param centerPos the position to look from
+		  */
+		void getTargetCandidates(SpectatorVec& list, const Position& centerPos) const;
 		
 		/**
 		  * Checks if you can throw an object to that position
@@ -275,16 +352,42 @@ class Map
 
 		QTreeNode root;
 
+		// direct index over the quad tree leaves, so lookups by position
+		// don't have to descend through every level of the tree
+		std::unique_ptr<LeafChunk> leafIndex[LEAF_CHUNK_COUNT * LEAF_CHUNK_COUNT];
+
+		QTreeLeafNode* getLeaf(uint32_t x, uint32_t y) const {
+			if (x > 0xFFFF || y > 0xFFFF) {
+				return nullptr;
+			}
+
+			const LeafChunk* chunk = leafIndex[(x >> LEAF_CHUNK_SHIFT) * LEAF_CHUNK_COUNT + (y >> LEAF_CHUNK_SHIFT)].get();
+			if (!chunk) {
+				return nullptr;
+			}
+			return chunk->leafs[(x >> FLOOR_BITS) & LEAF_CHUNK_MASK][(y >> FLOOR_BITS) & LEAF_CHUNK_MASK];
+		}
+		const Floor* getFloor(uint16_t x, uint16_t y, uint8_t z) const;
+
 		std::string spawnfile;
 		std::string housefile;
 
+		// tiles that received cleanable items, and the ones the running clean still has to visit
+		std::unordered_set<Tile*> cleanableTiles;
+		std::vector<Tile*> cleanQueue;
+
+		int64_t cleanStartTime;
+		int64_t cleanLongestSlice;
+		size_t cleanItems, cleanTiles, cleanSlices;
+
 		uint32_t width, height;
 
 		// Actually scans the map for spectators
 		void getSpectatorsInternal(SpectatorVec& list, const Position& centerPos,
 		                           int32_t minRangeX, int32_t maxRangeX,
 		                           int32_t minRangeY, int32_t maxRangeY,
-		                           int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers) const;
+		                           int32_t minRangeZ, int32_t maxRangeZ, CreatureVector Floor::* floorList) const;
+		static void getSpectatorFloors(const Position& centerPos, int32_t& minRangeZ, int32_t& maxRangeZ);
 
 		friend class Game;
 		friend class IOMap;
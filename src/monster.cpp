@@ -378,8 +378,16 @@ void Monster::updateTargetList()
 	}
 
 	SpectatorVec list;
-	g_game.map.getSpectators(list, _position, true);
-	list.erase(this);
+	if (isSummon() && getMaster()->getPlayer()) {
+		// a player's summon can fight anything but its master
+		g_game.map.getSpectators(list, _position, true);
+		list.erase(this);
+	} else {
+		// other monsters only target players and their summons, friends
+		// are found when they come into view or by updateFriendList
+		g_game.map.getTargetCandidates(list, _position);
+	}
+
 	for (Creature* spectator : list) {
 		if (canSee(spectator->getPosition())) {
 			onCreatureFound(spectator);
@@ -387,6 +395,22 @@ void Monster::updateTargetList()
 	}
 }
 
+void Monster::updateFriendList()
+{
+	if (isIdle) {
+		return;
+	}
+
+	SpectatorVec list;
+	g_game.map.getSpectators(list, _position, true);
+	list.erase(this);
+	for (Creature* spectator : list) {
+		if (isFriend(spectator) && canSee(spectator->getPosition())) {
+			addFriend(spectator);
+		}
+	}
+}
+
 void Monster::clearTargetList()
 {
 	for (Creature* creature : targetList) {
@@ -159,6 +159,7 @@ class Monster final : public Creature
 		const CreatureHashSet& getFriendList() const {
 			return friendList;
 		}
+		void updateFriendList();
 
 		bool isTarget(const Creature* creature) const;
 		bool isFleeing() const {
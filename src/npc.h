@@ -207,6 +207,9 @@ class Npc final : public Creature
 			return attackable;
 		}
 		bool getNextStep(Direction& dir, uint32_t& flags) final;
+		bool canSuspendThink() const final {
+			return conditions.empty();
+		}
 
 		bool canWalkTo(const Position& fromPos, Direction dir) const;
 		bool getRandomStep(Direction& dir) const;
@@ -47,10 +47,12 @@
 #include "databasemanager.h"
 #include "scheduler.h"
 #include "databasetasks.h"
+#include "workerpool.h"
 
 DatabaseTasks g_databaseTasks;
 Dispatcher g_dispatcher;
 Scheduler g_scheduler;
+WorkerPool g_workerPool;
 
 Game g_game;
 ConfigManager g_config;
@@ -123,6 +125,7 @@ int main(int argc, char* argv[])
 			g_dispatcher.addTask(createTask([]() {
 				g_scheduler.shutdown();
 				g_databaseTasks.shutdown();
+				g_workerPool.shutdown();
 				g_dispatcher.shutdown();
 			}));
 			g_scheduler.stop();
@@ -133,6 +136,7 @@ int main(int argc, char* argv[])
 
 	g_scheduler.join();
 	g_databaseTasks.join();
+	g_workerPool.join();
 	g_dispatcher.join();
 	return 0;
 }
@@ -172,6 +176,13 @@ void mainLoader(int, char*[], ServiceManager* services)
 		return;
 	}
 
+	int32_t workerThreads = g_config.getNumber(ConfigManager::WORKER_THREADS);
+	if (workerThreads < 0) {
+		// the dispatcher thread takes part in the work as well
+		workerThreads = std::max<int32_t>(std::thread::hardware_concurrency(), 1) - 1;
+	}
+	g_workerPool.start(workerThreads);
+
 #ifdef _WIN32
 	const std::string& defaultPriority = g_config.getString(ConfigManager::DEFAULT_PRIORITY);
 	if (strcasecmp(defaultPriority.c_str(), "high") == 0) {
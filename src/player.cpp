@@ -2247,6 +2247,7 @@ void Player::death(Creature* _lastHitCreature)
 			Condition* condition = *it;
 			if (condition->isPersistent()) {
 				it = conditions.erase(it);
+				updateConditionTypes();
 
 				condition->endCondition(this);
 				onEndCondition(condition->getType());
@@ -2263,6 +2264,7 @@ void Player::death(Creature* _lastHitCreature)
 			Condition* condition = *it;
 			if (condition->isPersistent()) {
 				it = conditions.erase(it);
+				updateConditionTypes();
 
 				condition->endCondition(this);
 				onEndCondition(condition->getType());
@@ -3051,7 +3053,23 @@ uint32_t Player::getItemTypeCount(uint16_t itemId, int32_t subType /*= -1*/) con
 			count += Item::countByType(item, subType);
 		}
 
-		if (Container* container = item->getContainer()) {
+		Container* container = item->getContainer();
+		if (!container) {
+			continue;
+		}
+
+		if (subType == -1) {
+			count += container->getContainedItemTypeCount(itemId);
+#ifndef NDEBUG
+			uint32_t scanCount = 0;
+			for (ContainerIterator it = container->iterator(); it.hasNext(); it.advance()) {
+				if ((*it)->getID() == itemId) {
+					scanCount += Item::countByType(*it, -1);
+				}
+			}
+			assert(scanCount == container->getContainedItemTypeCount(itemId));
+#endif
+		} else if (container->getContainedItemTypeCount(itemId) != 0) {
 			for (ContainerIterator it = container->iterator(); it.hasNext(); it.advance()) {
 				if ((*it)->getID() == itemId) {
 					count += Item::countByType(*it, subType);
@@ -3091,6 +3109,10 @@ bool Player::removeItemOfType(uint16_t itemId, uint32_t amount, int32_t subType,
 				return true;
 			}
 		} else if (Container* container = item->getContainer()) {
+			if (container->getContainedItemTypeCount(itemId) == 0) {
+				continue;
+			}
+
 			for (ContainerIterator it = container->iterator(); it.hasNext(); it.advance()) {
 				Item* containerItem = *it;
 				if (containerItem->getID() == itemId) {
@@ -3124,8 +3146,8 @@ std::map<uint32_t, uint32_t>& Player::getAllItemTypeCount(std::map<uint32_t, uin
 		countMap[item->getID()] += Item::countByType(item, -1);
 
 		if (Container* container = item->getContainer()) {
-			for (ContainerIterator it = container->iterator(); it.hasNext(); it.advance()) {
-				countMap[(*it)->getID()] += Item::countByType(*it, -1);
+			for (const auto& it : container->getContainedItemTypeCounts()) {
+				countMap[it.first] += it.second;
 			}
 		}
 	}
@@ -702,20 +702,14 @@ class Player final : public Creature, public Cylinder
 
 		//tile
 		//send methods
-		void sendAddTileItem(const Tile* tile, const Position& pos, const Item* item) {
-			if (client) {
-				int32_t stackpos = tile->getStackposOfItem(this, item);
-				if (stackpos != -1) {
-					client->sendAddTileItem(pos, stackpos, item);
-				}
+		void sendAddTileItem(const Position& pos, int32_t stackpos, const Item* item) {
+			if (stackpos != -1 && client) {
+				client->sendAddTileItem(pos, stackpos, item);
 			}
 		}
-		void sendUpdateTileItem(const Tile* tile, const Position& pos, const Item* item) {
-			if (client) {
-				int32_t stackpos = tile->getStackposOfItem(this, item);
-				if (stackpos != -1) {
-					client->sendUpdateTileItem(pos, stackpos, item);
-				}
+		void sendUpdateTileItem(const Position& pos, int32_t stackpos, const Item* item) {
+			if (stackpos != -1 && client) {
+				client->sendUpdateTileItem(pos, stackpos, item);
 			}
 		}
 		void sendRemoveTileThing(const Position& pos, int32_t stackpos) {
@@ -933,6 +927,11 @@ class Player final : public Creature, public Cylinder
 				client->sendMagicEffect(pos, type);
 			}
 		}
+		void sendMagicEffect(const std::vector<Position>& positions, uint8_t type) const {
+			if (client) {
+				client->sendMagicEffect(positions, type);
+			}
+		}
 		void sendPing();
 		void sendPingBack() const {
 			if (client) {
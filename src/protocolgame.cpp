@@ -2273,6 +2273,22 @@ void ProtocolGame::sendMagicEffect(const Position& pos, uint8_t type)
 	writeToOutputBuffer(msg);
 }
 
+void ProtocolGame::sendMagicEffect(const std::vector<Position>& positions, uint8_t type)
+{
+	NetworkMessage msg;
+	for (const Position& pos : positions) {
+		if (canSee(pos)) {
+			msg.addByte(0x83);
+			msg.addPosition(pos);
+			msg.addByte(type);
+		}
+	}
+
+	if (msg.getLength() != 0) {
+		writeToOutputBuffer(msg);
+	}
+}
+
 void ProtocolGame::sendCreatureHealth(const Creature* creature)
 {
 	NetworkMessage msg;
@@ -0,0 +1,188 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2015  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_SPECTATORS_H_A6237DFABFCA406AA6213B253E2E6AAA
+#define FS_SPECTATORS_H_A6237DFABFCA406AA6213B253E2E6AAA
+
+class Creature;
+
+// Flat list of unique creatures with room for the common viewport case
+// inline, so most spectator queries never touch the heap.
+class SpectatorVec
+{
+	public:
+		typedef Creature** iterator;
+		typedef Creature* const* const_iterator;
+
+		SpectatorVec() : data(inlineData), count(0), capacity(INLINE_CAPACITY) {}
+		~SpectatorVec() {
+			if (data != inlineData) {
+				delete[] data;
+			}
+		}
+
+		SpectatorVec(const SpectatorVec& other) : data(inlineData), count(0), capacity(INLINE_CAPACITY) {
+			assign(other);
+		}
+		SpectatorVec(SpectatorVec&& other) : data(inlineData), count(0), capacity(INLINE_CAPACITY) {
+			moveFrom(other);
+		}
+
+		SpectatorVec& operator=(const SpectatorVec& other) {
+			if (this != &other) {
+				assign(other);
+			}
+			return *this;
+		}
+		SpectatorVec& operator=(SpectatorVec&& other) {
+			if (this != &other) {
+				count = 0;
+				moveFrom(other);
+			}
+			return *this;
+		}
+
+		iterator begin() {
+			return data;
+		}
+		const_iterator begin() const {
+			return data;
+		}
+		iterator end() {
+			return data + count;
+		}
+		const_iterator end() const {
+			return data + count;
+		}
+
+		size_t size() const {
+			return count;
+		}
+		bool empty() const {
+			return count == 0;
+		}
+		void clear() {
+			count = 0;
+		}
+
+		bool contains(const Creature* creature) const {
+			return std::find(begin(), end(), creature) != end();
+		}
+
+		// Appends without checking for duplicates, only use it when the
+		// creature can not be in the list yet.
+		void emplace_back(Creature* creature) {
+			if (count == capacity) {
+				reserve(capacity * 2);
+			}
+			data[count++] = creature;
+		}
+
+		bool insert(Creature* creature) {
+			if (contains(creature)) {
+				return false;
+			}
+			emplace_back(creature);
+			return true;
+		}
+
+		bool erase(const Creature* creature) {
+			iterator it = std::find(begin(), end(), creature);
+			if (it == end()) {
+				return false;
+			}
+			*it = data[--count];
+			return true;
+		}
+
+		// Merges another list into this one, skipping creatures already present
+		void addSpectators(const SpectatorVec& other) {
+			if (count == 0) {
+				assign(other);
+				return;
+			}
+
+			const size_t oldCount = count;
+			reserve(count + other.count);
+			if (oldCount * other.count <= LINEAR_MERGE_LIMIT) {
+				for (Creature* creature : other) {
+					if (std::find(data, data + oldCount, creature) == data + oldCount) {
+						data[count++] = creature;
+					}
+				}
+			} else {
+				std::sort(data, data + oldCount);
+				for (Creature* creature : other) {
+					if (!std::binary_search(data, data + oldCount, creature)) {
+						data[count++] = creature;
+					}
+				}
+			}
+		}
+
+		void reserve(size_t newCapacity) {
+			if (newCapacity <= capacity) {
+				return;
+			}
+
+			Creature** newData = new Creature*[newCapacity];
+			std::copy(data, data + count, newData);
+			if (data != inlineData) {
+				delete[] data;
+			}
+			data = newData;
+			capacity = newCapacity;
+		}
+
+	private:
+		static const size_t INLINE_CAPACITY = 32;
+		static const size_t LINEAR_MERGE_LIMIT = 1024;
+
+		void assign(const SpectatorVec& other) {
+			count = 0;
+			reserve(other.count);
+			std::copy(other.begin(), other.end(), data);
+			count = other.count;
+		}
+
+		void moveFrom(SpectatorVec& other) {
+			if (other.data == other.inlineData) {
+				// inline storage can not be stolen, copy it over
+				assign(other);
+				other.count = 0;
+			} else {
+				if (data != inlineData) {
+					delete[] data;
+				}
+				data = other.data;
+				count = other.count;
+				capacity = other.capacity;
+				other.data = other.inlineData;
+				other.count = 0;
+				other.capacity = INLINE_CAPACITY;
+			}
+		}
+
+		Creature* inlineData[INLINE_CAPACITY];
+		Creature** data;
+		size_t count;
+		size_t capacity;
+};
+
+#endif
@@ -23,9 +23,11 @@
 
 #include "tile.h"
 
+#include "chunkpool.h"
 #include "creature.h"
 #include "combat.h"
 #include "game.h"
+#include "housetile.h"
 #include "mailbox.h"
 #include "monster.h"
 #include "movement.h"
@@ -39,6 +41,34 @@ extern MoveEvents* g_moveEvents;
 StaticTile real_nullptr_tile(0xFFFF, 0xFFFF, 0xFFFF);
 Tile& Tile::nullptr_tile = real_nullptr_tile;
 
+static ChunkPool& getTileChunkPool()
+{
+	// intentionally leaked, tiles are destroyed along with the map at exit
+	// and that must not depend on static destruction order
+	static ChunkPool* pool = new ChunkPool;
+	return *pool;
+}
+
+void* TileAllocator::allocate(size_t size)
+{
+	return getTileChunkPool().allocate(size);
+}
+
+void TileAllocator::deallocate(void* p, size_t size)
+{
+	getTileChunkPool().deallocate(p, size);
+}
+
+size_t TileAllocator::getAllocatedBytes()
+{
+	return getTileChunkPool().getAllocatedBytes();
+}
+
+size_t TileAllocator::getUsedBytes()
+{
+	return getTileChunkPool().getUsedBytes();
+}
+
 bool Tile::hasProperty(ITEMPROPERTY prop) const
 {
 	if (ground && ground->hasProperty(prop)) {
@@ -381,6 +411,10 @@ void Tile::onAddTileItem(Item* item)
 		}
 	}
 
+	if (item->isCleanable() && !hasFlag(TILESTATE_PROTECTIONZONE)) {
+		g_game.map.addCleanableTile(this);
+	}
+
 	setTileFlags(item);
 
 	const Position& cylinderMapPos = getPosition();
@@ -388,10 +422,14 @@ void Tile::onAddTileItem(Item* item)
 	SpectatorVec list;
 	g_game.map.getSpectators(list, cylinderMapPos, true);
 
+	std::vector<int32_t> stackPosVector;
+	getStackposOfItem(list, item, stackPosVector);
+
 	//send to client
+	size_t i = 0;
 	for (Creature* spectator : list) {
 		if (Player* tmpPlayer = spectator->getPlayer()) {
-			tmpPlayer->sendAddTileItem(this, cylinderMapPos, item);
+			tmpPlayer->sendAddTileItem(cylinderMapPos, stackPosVector[i++], item);
 		}
 	}
 
@@ -421,15 +459,23 @@ void Tile::onUpdateTileItem(Item* oldItem, const ItemType& oldType, Item* newIte
 		}
 	}
 
+	if (newItem->isCleanable() && !hasFlag(TILESTATE_PROTECTIONZONE)) {
+		g_game.map.addCleanableTile(this);
+	}
+
 	const Position& cylinderMapPos = getPosition();
 
 	SpectatorVec list;
 	g_game.map.getSpectators(list, cylinderMapPos, true);
 
+	std::vector<int32_t> stackPosVector;
+	getStackposOfItem(list, newItem, stackPosVector);
+
 	//send to client
+	size_t i = 0;
 	for (Creature* spectator : list) {
 		if (Player* tmpPlayer = spectator->getPlayer()) {
-			tmpPlayer->sendUpdateTileItem(this, cylinderMapPos, newItem);
+			tmpPlayer->sendUpdateTileItem(cylinderMapPos, stackPosVector[i++], newItem);
 		}
 	}
 
@@ -1053,11 +1099,6 @@ void Tile::removeThing(Thing* thing, uint32_t count)
 		return;
 	}
 
-	int32_t index = getThingIndex(item);
-	if (index == -1) {
-		return;
-	}
-
 	if (item == ground) {
 		ground->setParent(nullptr);
 		ground = nullptr;
@@ -1080,15 +1121,11 @@ void Tile::removeThing(Thing* thing, uint32_t count)
 			return;
 		}
 
-		std::vector<int32_t> oldStackPosVector;
-
 		SpectatorVec list;
 		g_game.map.getSpectators(list, getPosition(), true);
-		for (Creature* spectator : list) {
-			if (Player* tmpPlayer = spectator->getPlayer()) {
-				oldStackPosVector.push_back(getStackposOfItem(tmpPlayer, item));
-			}
-		}
+
+		std::vector<int32_t> oldStackPosVector;
+		getStackposOfItem(list, item, oldStackPosVector);
 
 		item->setParent(nullptr);
 		items->erase(it);
@@ -1104,15 +1141,11 @@ void Tile::removeThing(Thing* thing, uint32_t count)
 			item->setItemCount(newCount);
 			onUpdateTileItem(item, itemType, item, itemType);
 		} else {
-			std::vector<int32_t> oldStackPosVector;
-
 			SpectatorVec list;
 			g_game.map.getSpectators(list, getPosition(), true);
-			for (Creature* spectator : list) {
-				if (Player* tmpPlayer = spectator->getPlayer()) {
-					oldStackPosVector.push_back(getStackposOfItem(tmpPlayer, item));
-				}
-			}
+
+			std::vector<int32_t> oldStackPosVector;
+			getStackposOfItem(list, item, oldStackPosVector);
 
 			item->setParent(nullptr);
 			items->erase(it);
@@ -1124,7 +1157,7 @@ void Tile::removeThing(Thing* thing, uint32_t count)
 
 void Tile::removeCreature(Creature* creature)
 {
-	qt_node->removeCreature(creature);
+	qt_node->removeCreature(creature, tilePos.z);
 	removeThing(creature, 0);
 }
 
@@ -1239,6 +1272,40 @@ int32_t Tile::getStackposOfCreature(const Player* player, const Creature* creatu
 
 int32_t Tile::getStackposOfItem(const Player* player, const Item* item) const
 {
+	bool belowCreatures;
+	int32_t n = getItemStackposBase(item, belowCreatures);
+	if (n == -1 || !belowCreatures) {
+		return n;
+	}
+	return addVisibleCreatures(player, n);
+}
+
+void Tile::getStackposOfItem(const SpectatorVec& list, const Item* item, std::vector<int32_t>& stackPosVector) const
+{
+	// only the creatures in front of the item depend on who is looking, the
+	// rest of the position is the same for every spectator
+	bool belowCreatures;
+	int32_t n = getItemStackposBase(item, belowCreatures);
+	if (n != -1 && belowCreatures) {
+		const CreatureVector* creatures = getCreatures();
+		belowCreatures = creatures && !creatures->empty();
+	}
+
+	for (Creature* spectator : list) {
+		if (Player* tmpPlayer = spectator->getPlayer()) {
+			if (n != -1 && belowCreatures) {
+				stackPosVector.push_back(addVisibleCreatures(tmpPlayer, n));
+			} else {
+				stackPosVector.push_back(n);
+			}
+		}
+	}
+}
+
+int32_t Tile::getItemStackposBase(const Item* item, bool& belowCreatures) const
+{
+	belowCreatures = false;
+
 	int32_t n = 0;
 	if (ground) {
 		if (ground == item) {
@@ -1248,43 +1315,45 @@ int32_t Tile::getStackposOfItem(const Player* player, const Item* item) const
 	}
 
 	const TileItemVector* items = getItemList();
-	if (items) {
-		if (item->isAlwaysOnTop()) {
-			for (ItemVector::const_iterator it = items->getBeginTopItem(), end = items->getEndTopItem(); it != end; ++it) {
-				if (*it == item) {
-					return n;
-				} else if (++n == 10) {
-					return -1;
-				}
-			}
-		} else {
-			n += items->getTopItemCount();
-			if (n >= 10) {
+	if (!items) {
+		return -1;
+	}
+
+	if (item->isAlwaysOnTop()) {
+		for (ItemVector::const_iterator it = items->getBeginTopItem(), end = items->getEndTopItem(); it != end; ++it) {
+			if (*it == item) {
+				return n;
+			} else if (++n == 10) {
 				return -1;
 			}
 		}
+		return -1;
 	}
 
-	if (const CreatureVector* creatures = getCreatures()) {
-		for (const Creature* creature : *creatures) {
-			if (player->canSeeCreature(creature)) {
-				if (++n >= 10) {
-					return -1;
-				}
-			}
+	belowCreatures = true;
+
+	// the client only knows the first ten things on a tile, so at most that
+	// many down items are looked at however high the pile is
+	n += items->getTopItemCount();
+	for (ItemVector::const_iterator it = items->getBeginDownItem(), end = items->getEndDownItem(); it != end && n < 10; ++it) {
+		if (*it == item) {
+			return n;
 		}
+		++n;
 	}
+	return -1;
+}
 
-	if (items && !item->isAlwaysOnTop()) {
-		for (ItemVector::const_iterator it = items->getBeginDownItem(), end = items->getEndDownItem(); it != end; ++it) {
-			if (*it == item) {
-				return n;
-			} else if (++n >= 10) {
+int32_t Tile::addVisibleCreatures(const Player* player, int32_t stackpos) const
+{
+	if (const CreatureVector* creatures = getCreatures()) {
+		for (const Creature* creature : *creatures) {
+			if (player->canSeeCreature(creature) && ++stackpos >= 10) {
 				return -1;
 			}
 		}
 	}
-	return -1;
+	return stackpos;
 }
 
 size_t Tile::getFirstIndex() const
@@ -1347,6 +1416,13 @@ Thing* Tile::getThing(size_t index) const
 	return nullptr;
 }
 
+void Tile::setHouseItemsChanged()
+{
+	if (hasFlag(TILESTATE_HOUSE)) {
+		static_cast<HouseTile*>(this)->getHouse()->setItemsChanged(true);
+	}
+}
+
 void Tile::postAddNotification(Thing* thing, const Cylinder* oldParent, int32_t index, cylinderlink_t link /*= LINK_OWNER*/)
 {
 	SpectatorVec list;
@@ -1365,6 +1441,7 @@ void Tile::postAddNotification(Thing* thing, const Cylinder* oldParent, int32_t
 		item = thing->getItem();
 		if (item) {
 			item->incrementReferenceCounter();
+			setHouseItemsChanged();
 		}
 	}
 
@@ -1423,6 +1500,7 @@ void Tile::postRemoveNotification(Thing* thing, const Cylinder* newParent, int32
 	} else {
 		Item* item = thing->getItem();
 		if (item) {
+			setHouseItemsChanged();
 			g_moveEvents->onItemMove(item, this, false);
 		}
 	}
@@ -1556,6 +1634,10 @@ void Tile::setTileFlags(const Item* item)
 		setFlag(TILESTATE_BLOCKSOLID);
 	}
 
+	if (item->hasProperty(CONST_PROP_BLOCKPROJECTILE)) {
+		setFlag(TILESTATE_BLOCKPROJECTILE);
+	}
+
 	if (item->getBed()) {
 		setFlag(TILESTATE_BED);
 	}
@@ -1568,6 +1650,8 @@ void Tile::setTileFlags(const Item* item)
 	if (item->hasProperty(CONST_PROP_SUPPORTHANGABLE)) {
 		setFlag(TILESTATE_SUPPORTS_HANGABLE);
 	}
+
+	updateBlockMasks();
 }
 
 void Tile::resetTileFlags(const Item* item)
@@ -1612,6 +1696,10 @@ void Tile::resetTileFlags(const Item* item)
 		resetFlag(TILESTATE_BLOCKSOLID);
 	}
 
+	if (item->hasProperty(CONST_PROP_BLOCKPROJECTILE) && !hasProperty(item, CONST_PROP_BLOCKPROJECTILE)) {
+		resetFlag(TILESTATE_BLOCKPROJECTILE);
+	}
+
 	if (item->hasProperty(CONST_PROP_IMMOVABLEBLOCKSOLID) && !hasProperty(item, CONST_PROP_IMMOVABLEBLOCKSOLID)) {
 		resetFlag(TILESTATE_IMMOVABLEBLOCKSOLID);
 	}
@@ -1660,6 +1748,45 @@ void Tile::resetTileFlags(const Item* item)
 	if (item->hasProperty(CONST_PROP_SUPPORTHANGABLE)) {
 		resetFlag(TILESTATE_SUPPORTS_HANGABLE);
 	}
+
+	updateBlockMasks();
+}
+
+void Tile::updateBlockMasks()
+{
+	if (!qt_node) {
+		return;
+	}
+
+	const Position& tilePos = getPosition();
+	Floor* floor = qt_node->getFloor(tilePos.z);
+	if (!floor) {
+		return;
+	}
+
+	// only what rejects every creature in queryAdd may be set here: no ground,
+	// or an immovable solid item (players and npcs only check it with items)
+	bool solid = !ground || (hasFlag(TILESTATE_IMMOVABLEBLOCKSOLID) && getItemList());
+	bool path = solid || floorChange() || positionChange();
+
+	const uint64_t bit = Floor::getMaskBit(tilePos.x, tilePos.y);
+	if (solid) {
+		floor->blockSolid |= bit;
+	} else {
+		floor->blockSolid &= ~bit;
+	}
+
+	if (path) {
+		floor->blockPath |= bit;
+	} else {
+		floor->blockPath &= ~bit;
+	}
+
+	if (hasFlag(TILESTATE_BLOCKPROJECTILE)) {
+		floor->blockProjectile |= bit;
+	} else {
+		floor->blockProjectile &= ~bit;
+	}
 }
 
 bool Tile::isMoveableBlocking() const
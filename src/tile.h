@@ -20,11 +20,10 @@
 #ifndef FS_TILE_H_96C7EE7CF8CD48E59D5D554A181F0C56
 #define FS_TILE_H_96C7EE7CF8CD48E59D5D554A181F0C56
 
-#include <unordered_set>
-
 #include "cylinder.h"
 #include "item.h"
 #include "tools.h"
+#include "spectators.h"
 
 class Creature;
 class Teleport;
@@ -36,7 +35,6 @@ class BedItem;
 
 typedef std::vector<Creature*> CreatureVector;
 typedef std::vector<Item*> ItemVector;
-typedef std::unordered_set<Creature*> SpectatorVec;
 
 enum tileflags_t {
 	TILESTATE_NONE,
@@ -72,6 +70,7 @@ enum tileflags_t {
 	TILESTATE_FLOORCHANGE_SOUTH_ALT = 1 << 26,
 	TILESTATE_FLOORCHANGE_EAST_ALT = 1 << 27,
 	TILESTATE_SUPPORTS_HANGABLE = 1 << 28,
+	TILESTATE_BLOCKPROJECTILE = 1 << 29,
 };
 
 enum ZoneType_t {
@@ -82,11 +81,31 @@ enum ZoneType_t {
 	ZONE_NORMAL,
 };
 
+// Tiles and their item lists live as long as the map does, so they are
+// carved out of large chunks instead of paying the allocator overhead
+// (and fragmentation) for every single one of them.
+class TileAllocator
+{
+	public:
+		static void* allocate(size_t size);
+		static void deallocate(void* p, size_t size);
+
+		static size_t getAllocatedBytes();
+		static size_t getUsedBytes();
+};
+
 class TileItemVector
 {
 	public:
 		TileItemVector() : downItemCount(0) {}
 
+		static void* operator new(size_t size) {
+			return TileAllocator::allocate(size);
+		}
+		static void operator delete(void* p, size_t size) {
+			TileAllocator::deallocate(p, size);
+		}
+
 		ItemVector::const_iterator begin() const {
 			return items.begin();
 		}
@@ -187,6 +206,13 @@ class Tile : public Cylinder
 		Tile(const Tile&) = delete;
 		Tile& operator=(const Tile&) = delete;
 
+		static void* operator new(size_t size) {
+			return TileAllocator::allocate(size);
+		}
+		static void operator delete(void* p, size_t size) {
+			TileAllocator::deallocate(p, size);
+		}
+
 		TileItemVector* getItemList();
 		const TileItemVector* getItemList() const;
 		TileItemVector* makeItemList();
@@ -244,9 +270,14 @@ class Tile : public Cylinder
 			m_flags &= ~static_cast<uint32_t>(flag);
 		}
 
+		void setHouseItemsChanged();
+
 		bool positionChange() const {
 			return hasFlag(TILESTATE_TELEPORT);
 		}
+
+		// refreshes the bits of this tile in the Floor block masks
+		void updateBlockMasks();
 		bool floorChange() const {
 			return hasFlag(TILESTATE_FLOORCHANGE);
 		}
@@ -297,6 +328,7 @@ class Tile : public Cylinder
 		int32_t getClientIndexOfCreature(const Player* player, const Creature* creature) const;
 		int32_t getStackposOfCreature(const Player* player, const Creature* creature) const;
 		int32_t getStackposOfItem(const Player* player, const Item* item) const;
+		void getStackposOfItem(const SpectatorVec& list, const Item* item, std::vector<int32_t>& stackPosVector) const;
 
 		//cylinder implementations
 		ReturnValue queryAdd(int32_t index, const Thing& thing, uint32_t count,
@@ -347,6 +379,9 @@ class Tile : public Cylinder
 		void setTileFlags(const Item* item);
 		void resetTileFlags(const Item* item);
 
+		int32_t getItemStackposBase(const Item* item, bool& belowCreatures) const;
+		int32_t addVisibleCreatures(const Player* player, int32_t stackpos) const;
+
 	protected:
 		// Put this first for cache-coherency
 		bool isDynamic() const {
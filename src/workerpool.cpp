@@ -0,0 +1,114 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2015  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "workerpool.h"
+
+WorkerPool::WorkerPool() :
+	job(nullptr), nextJob(0), jobCount(0), busyWorkers(0), generation(0)
+{
+	threadState = THREAD_STATE_TERMINATED;
+}
+
+void WorkerPool::start(size_t threadCount)
+{
+	threadState = THREAD_STATE_RUNNING;
+	for (size_t i = 0; i < threadCount; ++i) {
+		threads.emplace_back(&WorkerPool::workerThread, this);
+	}
+}
+
+void WorkerPool::workerThread()
+{
+	uint64_t lastGeneration = 0;
+
+	std::unique_lock<std::mutex> jobLockUnique(jobLock);
+	while (true) {
+		jobSignal.wait(jobLockUnique, [&]() {
+			return threadState == THREAD_STATE_TERMINATED || generation != lastGeneration;
+		});
+
+		if (threadState == THREAD_STATE_TERMINATED) {
+			break;
+		}
+
+		lastGeneration = generation;
+		jobLockUnique.unlock();
+
+		runJobs();
+
+		jobLockUnique.lock();
+		if (--busyWorkers == 0) {
+			doneSignal.notify_one();
+		}
+	}
+}
+
+void WorkerPool::runJobs()
+{
+	size_t index;
+	while ((index = nextJob++) < jobCount) {
+		(*job)(index);
+	}
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void (size_t)>& f)
+{
+	if (threads.empty() || threadState != THREAD_STATE_RUNNING || count <= 1) {
+		for (size_t i = 0; i < count; ++i) {
+			f(i);
+		}
+		return;
+	}
+
+	std::unique_lock<std::mutex> jobLockUnique(jobLock);
+	job = &f;
+	jobCount = count;
+	nextJob = 0;
+	busyWorkers = threads.size();
+	++generation;
+	jobLockUnique.unlock();
+	jobSignal.notify_all();
+
+	// the calling thread takes part as well
+	runJobs();
+
+	jobLockUnique.lock();
+	doneSignal.wait(jobLockUnique, [this]() { return busyWorkers == 0; });
+	job = nullptr;
+}
+
+void WorkerPool::shutdown()
+{
+	jobLock.lock();
+	threadState = THREAD_STATE_TERMINATED;
+	jobLock.unlock();
+	jobSignal.notify_all();
+}
+
+void WorkerPool::join()
+{
+	for (std::thread& thread : threads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+	threads.clear();
+}
@@ -0,0 +1,69 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2015  Mark Samman <mark.samman@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_WORKERPOOL_H_D68DFE8BA8844BB6BF62F1247E8C8FE0
+#define FS_WORKERPOOL_H_D68DFE8BA8844BB6BF62F1247E8C8FE0
+
+#include <atomic>
+#include <condition_variable>
+
+#include "enums.h"
+
+class WorkerPool
+{
+	public:
+		WorkerPool();
+
+		// non-copyable
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+
+		void start(size_t threadCount);
+		void shutdown();
+		void join();
+
+		size_t getThreadCount() const {
+			return threads.size();
+		}
+
+		// Runs job(i) for every i in [0, count) on the worker threads and the
+		// calling thread, and returns once all of them have finished.
+		// Jobs must not touch anything the other jobs may modify.
+		void parallelFor(size_t count, const std::function<void (size_t)>& job);
+
+	protected:
+		void workerThread();
+		void runJobs();
+
+		std::vector<std::thread> threads;
+		std::mutex jobLock;
+		std::condition_variable jobSignal;
+		std::condition_variable doneSignal;
+
+		const std::function<void (size_t)>* job;
+		std::atomic<size_t> nextJob;
+		size_t jobCount;
+		size_t busyWorkers;
+		uint64_t generation;
+		ThreadState threadState;
+};
+
+extern WorkerPool g_workerPool;
+
+#endif